@@ -139,6 +139,52 @@ block_write (struct block *block, block_sector_t sector, const void *buffer)
   block->write_cnt++;
 }
 
+/* Reads the CNT sectors of BLOCK starting at SECTOR into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes, in one
+   transfer if the driver supports it. */
+void
+block_read_run (struct block *block, block_sector_t sector, size_t cnt,
+                void *buffer_)
+{
+  uint8_t *buffer = buffer_;
+  size_t i;
+
+  if (cnt == 0)
+    return;
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  if (block->ops->read_run != NULL)
+    block->ops->read_run (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      block->ops->read (block->aux, sector + i, buffer + i * BLOCK_SECTOR_SIZE);
+  block->read_cnt += cnt;
+}
+
+/* Writes the CNT sectors of BLOCK starting at SECTOR from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes, in one
+   transfer if the driver supports it. */
+void
+block_write_run (struct block *block, block_sector_t sector, size_t cnt,
+                 const void *buffer_)
+{
+  const uint8_t *buffer = buffer_;
+  size_t i;
+
+  if (cnt == 0)
+    return;
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  ASSERT (block->type != BLOCK_FOREIGN);
+  if (block->ops->write_run != NULL)
+    block->ops->write_run (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      block->ops->write (block->aux, sector + i,
+                         buffer + i * BLOCK_SECTOR_SIZE);
+  block->write_cnt += cnt;
+}
+
 /* Returns the number of sectors in BLOCK. */
 block_sector_t
 block_size (struct block *block)
@@ -178,6 +224,16 @@ block_print_stats (void)
     }
 }
 
+/* Stores the number of sectors read from and written to BLOCK so
+   far into *READ_CNT and *WRITE_CNT. */
+void
+block_get_stats (struct block *block, unsigned long long *read_cnt,
+                 unsigned long long *write_cnt)
+{
+  *read_cnt = block->read_cnt;
+  *write_cnt = block->write_cnt;
+}
+
 /* Registers a new block device with the given NAME.  If
    EXTRA_INFO is non-null, it is printed as part of a user
    message.  The block device's SIZE in sectors and its TYPE must
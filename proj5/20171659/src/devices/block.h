@@ -53,11 +53,16 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_run (struct block *, block_sector_t, size_t cnt, void *);
+void block_write_run (struct block *, block_sector_t, size_t cnt,
+                      const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
 /* Statistics. */
 void block_print_stats (void);
+void block_get_stats (struct block *, unsigned long long *read_cnt,
+                      unsigned long long *write_cnt);
 
 /* Lower-level interface to block device drivers. */
 
@@ -65,6 +70,11 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Optional: transfer CNT consecutive sectors at once. */
+    void (*read_run) (void *aux, block_sector_t, size_t cnt, void *buffer);
+    void (*write_run) (void *aux, block_sector_t, size_t cnt,
+                       const void *buffer);
   };
 
 struct block *block_register (const char *name, enum block_type,
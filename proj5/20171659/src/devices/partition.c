@@ -317,8 +317,30 @@ partition_write (void *p_, block_sector_t sector, const void *buffer)
   block_write (p->block, p->start + sector, buffer);
 }
 
+/* Reads the CNT sectors of partition P starting at SECTOR into
+   BUFFER. */
+static void
+partition_read_run (void *p_, block_sector_t sector, size_t cnt,
+                    void *buffer)
+{
+  struct partition *p = p_;
+  block_read_run (p->block, p->start + sector, cnt, buffer);
+}
+
+/* Writes the CNT sectors of partition P starting at SECTOR from
+   BUFFER. */
+static void
+partition_write_run (void *p_, block_sector_t sector, size_t cnt,
+                     const void *buffer)
+{
+  struct partition *p = p_;
+  block_write_run (p->block, p->start + sector, cnt, buffer);
+}
+
 static struct block_operations partition_operations =
   {
     partition_read,
-    partition_write
+    partition_write,
+    partition_read_run,
+    partition_write_run
   };
@@ -2,6 +2,40 @@
 #include <string.h>
 #include "filesys/buffer_cache.h"
 #include "filesys/filesys.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#endif
+
+/* Slots that share one page of buffers beyond BUFFER_CACHE_SIZE. */
+#define SLOTS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Buffers of the slots the cache always has. */
+static uint8_t base_buffers[BUFFER_CACHE_SIZE][BLOCK_SECTOR_SIZE];
+
+/* Number of slots in use in cache[]. */
+static size_t bc_cnt;
+
+/* Number of slots holding delayed-allocation blocks. */
+static size_t delayed_cnt;
+
+/* Set when a slot had to be evicted while at least half of
+   BC_DELAYED_MAX slots held delayed blocks, which eviction skips. */
+static bool delayed_pressure;
+
+/* Metadata slots that data traffic leaves alone. */
+static size_t bc_meta_floor = BC_META_FLOOR;
+
+static struct bc_entry_t *bc_lookup_delayed (block_sector_t owner,
+                                             off_t index);
+static void bc_read_class (block_sector_t sector, void *target, bool meta);
+static void bc_write_class (block_sector_t sector, const void *source,
+                            block_sector_t owner, bool meta);
+static bool bc_grow (void);
+static size_t bc_shrink (size_t page_cnt);
+
+static struct shrinker bc_shrinker = { .shrink = bc_shrink, .user = true };
 
 void
 bc_init (void)
@@ -9,14 +43,38 @@ bc_init (void)
   lock_init (&bc_lock);
 
   for (int i = 0; i < BUFFER_CACHE_SIZE; i++){
+    cache[i].buffer = base_buffers[i];
     cache[i].valid = false;
     cache[i].dirty = false;
     cache[i].access = false;
+    cache[i].pinned = false;
+    cache[i].delayed = false;
+    cache[i].meta = false;
   }
+  bc_cnt = BUFFER_CACHE_SIZE;
+  delayed_cnt = 0;
+  delayed_pressure = false;
+
+  palloc_register_shrinker (&bc_shrinker);
 }
 
 void
 bc_read (block_sector_t sector, void *target)
+{
+  bc_read_class (sector, target, false);
+}
+
+/* Reads SECTOR like bc_read(), marking it metadata: an inode, an
+   index block or a directory block.  Data traffic cannot push
+   metadata slots below bc_meta_floor. */
+void
+bc_read_meta (block_sector_t sector, void *target)
+{
+  bc_read_class (sector, target, true);
+}
+
+static void
+bc_read_class (block_sector_t sector, void *target, bool meta)
 {
   lock_acquire (&bc_lock);
 
@@ -24,22 +82,43 @@ bc_read (block_sector_t sector, void *target)
   
   //not in cache
   if (slot == NULL) {
-    slot = bc_select_victim ();
+    slot = bc_select_victim (meta);
     block_read (fs_device, sector, slot->buffer);
 
     slot->disk_sector = sector;
     slot->valid = true;
     slot->dirty = false;
+    slot->meta = meta;
   }
 
   slot->access = true;
+  slot->meta |= meta;
   memcpy(target, slot->buffer, BLOCK_SECTOR_SIZE);
 
   lock_release (&bc_lock);
 }
 
+/* Writes SOURCE to SECTOR in the cache, recording that the slot
+   belongs to the inode at sector OWNER so bc_flush_inode() can
+   find it. */
+void
+bc_write (block_sector_t sector, const void *source, block_sector_t owner)
+{
+  bc_write_class (sector, source, owner, false);
+}
+
+/* Writes SECTOR like bc_write(), marking it metadata as
+   bc_read_meta() does. */
 void
-bc_write (block_sector_t sector, const void *source)
+bc_write_meta (block_sector_t sector, const void *source,
+               block_sector_t owner)
+{
+  bc_write_class (sector, source, owner, true);
+}
+
+static void
+bc_write_class (block_sector_t sector, const void *source,
+                block_sector_t owner, bool meta)
 {
   lock_acquire (&bc_lock);
 
@@ -47,7 +126,7 @@ bc_write (block_sector_t sector, const void *source)
 
   //not in cache
   if (slot == NULL) {
-    slot = bc_select_victim ();
+    slot = bc_select_victim (meta);
     block_read (fs_device, sector, slot->buffer);
 
     slot->disk_sector = sector;
@@ -57,11 +136,287 @@ bc_write (block_sector_t sector, const void *source)
 
   slot->access = true;
   slot->dirty = true;
+  slot->owner = owner;
+  slot->meta = meta;
   memcpy(slot->buffer, source, BLOCK_SECTOR_SIZE);
 
   lock_release (&bc_lock);
 }
 
+/* Writes SIZE bytes from SOURCE at OFS within SECTOR in the cache,
+   leaving the rest of the sector as it was, and records OWNER like
+   bc_write().  Only packed metadata such as inode table slots is
+   written this way, so the slot counts as metadata. */
+void
+bc_write_at (block_sector_t sector, int ofs, const void *source, int size,
+             block_sector_t owner)
+{
+  ASSERT (ofs >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&bc_lock);
+
+  struct bc_entry_t *slot = bc_lookup (sector);
+
+  //not in cache
+  if (slot == NULL) {
+    slot = bc_select_victim (true);
+    block_read (fs_device, sector, slot->buffer);
+
+    slot->disk_sector = sector;
+    slot->valid = true;
+    slot->dirty = false;
+  }
+
+  slot->access = true;
+  slot->dirty = true;
+  slot->owner = owner;
+  slot->meta = true;
+  memcpy(slot->buffer + ofs, source, size);
+
+  lock_release (&bc_lock);
+}
+
+/* Reads SECTOR into TARGET for a caller that keeps its own copy,
+   bypassing the cache.  A slot that already holds SECTOR is handed
+   over instead and freed, so the data is not cached twice.
+   Returns true if that slot was dirty, that is, if TARGET is now
+   newer than the disk. */
+bool
+bc_take (block_sector_t sector, void *target)
+{
+  bool dirty = false;
+
+  lock_acquire (&bc_lock);
+
+  struct bc_entry_t *slot = bc_lookup (sector);
+  if (slot != NULL) {
+    memcpy (target, slot->buffer, BLOCK_SECTOR_SIZE);
+    dirty = slot->dirty;
+    slot->valid = false;
+    slot->dirty = false;
+  }
+  else
+    block_read (fs_device, sector, target);
+
+  lock_release (&bc_lock);
+  return dirty;
+}
+
+/* Reads SECTOR into TARGET straight from disk without caching it,
+   unless a slot already holds SECTOR, in which case that slot is
+   copied instead since it may be newer than the disk. */
+void
+bc_read_around (block_sector_t sector, void *target)
+{
+  lock_acquire (&bc_lock);
+
+  struct bc_entry_t *slot = bc_lookup (sector);
+  if (slot != NULL)
+    memcpy (target, slot->buffer, BLOCK_SECTOR_SIZE);
+  else
+    block_read (fs_device, sector, target);
+
+  lock_release (&bc_lock);
+}
+
+/* Writes SOURCE to SECTOR straight to disk, unless a slot already
+   holds SECTOR, in which case that slot is updated instead so that
+   it never goes stale. */
+void
+bc_write_around (block_sector_t sector, const void *source,
+                 block_sector_t owner)
+{
+  lock_acquire (&bc_lock);
+
+  struct bc_entry_t *slot = bc_lookup (sector);
+  if (slot != NULL) {
+    slot->access = true;
+    slot->dirty = true;
+    slot->owner = owner;
+    memcpy (slot->buffer, source, BLOCK_SECTOR_SIZE);
+  }
+  else
+    block_write (fs_device, sector, source);
+
+  lock_release (&bc_lock);
+}
+
+/* Copies SIZE bytes from SRC_OFS in sector SRC to DST_OFS in
+   sector DST slot-to-slot, without a bounce buffer.  DST is not
+   read from disk when it is overwritten entirely, and is recorded
+   as belonging to the inode at sector OWNER. */
+void
+bc_copy (block_sector_t dst, int dst_ofs,
+         block_sector_t src, int src_ofs, int size, block_sector_t owner)
+{
+  ASSERT (dst_ofs >= 0 && dst_ofs + size <= BLOCK_SECTOR_SIZE);
+  ASSERT (src_ofs >= 0 && src_ofs + size <= BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&bc_lock);
+
+  struct bc_entry_t *from = bc_lookup (src);
+
+  //not in cache
+  if (from == NULL) {
+    from = bc_select_victim (false);
+    block_read (fs_device, src, from->buffer);
+
+    from->disk_sector = src;
+    from->valid = true;
+    from->dirty = false;
+    from->meta = false;
+  }
+
+  //keep source while choosing a slot for destination
+  from->access = true;
+  from->pinned = true;
+
+  struct bc_entry_t *to = bc_lookup (dst);
+
+  //not in cache
+  if (to == NULL) {
+    to = bc_select_victim (false);
+    if (size < BLOCK_SECTOR_SIZE)
+      block_read (fs_device, dst, to->buffer);
+
+    to->disk_sector = dst;
+    to->valid = true;
+    to->dirty = false;
+  }
+
+  to->access = true;
+  to->dirty = true;
+  to->owner = owner;
+  to->meta = false;
+  memmove (to->buffer + dst_ofs, from->buffer + src_ofs, size);
+
+  from->pinned = false;
+
+  lock_release (&bc_lock);
+}
+
+/* Returns how many more delayed-allocation blocks the cache can
+   take before they would crowd out ordinary slots. */
+size_t
+bc_delayed_room (void)
+{
+  return BC_DELAYED_MAX - delayed_cnt;
+}
+
+/* Returns true, once, if the cache has had to evict around many
+   delayed blocks since it last did, in which case the caller
+   should give them sectors so that they can be written back. */
+bool
+bc_delayed_pressure (void)
+{
+  lock_acquire (&bc_lock);
+  bool pressure = delayed_pressure;
+  delayed_pressure = false;
+  lock_release (&bc_lock);
+  return pressure;
+}
+
+/* Reads block INDEX of the inode at sector OWNER, which has no
+   disk sector yet, into TARGET.  A block that was never written
+   reads as zeros. */
+void
+bc_read_delayed (block_sector_t owner, off_t index, void *target)
+{
+  lock_acquire (&bc_lock);
+
+  struct bc_entry_t *slot = bc_lookup_delayed (owner, index);
+  if (slot == NULL)
+    memset (target, 0, BLOCK_SECTOR_SIZE);
+  else {
+    slot->access = true;
+    memcpy (target, slot->buffer, BLOCK_SECTOR_SIZE);
+  }
+
+  lock_release (&bc_lock);
+}
+
+/* Writes SIZE bytes from SOURCE at OFS within block INDEX of the
+   inode at sector OWNER.  The block lives only in the cache, and
+   cannot be evicted, until bc_assign_delayed() gives it a disk
+   sector.  Returns false, writing nothing, if the block is new and
+   BC_DELAYED_MAX slots are already delayed. */
+bool
+bc_write_delayed (block_sector_t owner, off_t index, int ofs,
+                  const void *source, int size)
+{
+  ASSERT (ofs >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&bc_lock);
+
+  struct bc_entry_t *slot = bc_lookup_delayed (owner, index);
+
+  //not in cache, start from zeros
+  if (slot == NULL) {
+    if (delayed_cnt >= BC_DELAYED_MAX) {
+      lock_release (&bc_lock);
+      return false;
+    }
+    slot = bc_select_victim (false);
+    memset (slot->buffer, 0, BLOCK_SECTOR_SIZE);
+
+    slot->owner = owner;
+    slot->index = index;
+    slot->valid = true;
+    slot->delayed = true;
+    slot->meta = false;
+    delayed_cnt++;
+  }
+
+  slot->access = true;
+  slot->dirty = true;
+  memcpy (slot->buffer + ofs, source, size);
+
+  lock_release (&bc_lock);
+  return true;
+}
+
+/* Gives delayed block INDEX of the inode at sector OWNER its disk
+   SECTOR, turning it into an ordinary dirty slot that will be
+   written back like any other.  Returns false if the block was
+   never written, in which case the caller must zero SECTOR. */
+bool
+bc_assign_delayed (block_sector_t owner, off_t index, block_sector_t sector)
+{
+  lock_acquire (&bc_lock);
+
+  struct bc_entry_t *slot = bc_lookup_delayed (owner, index);
+  if (slot != NULL) {
+    //stale copy of the sector's previous contents
+    struct bc_entry_t *stale = bc_lookup (sector);
+    if (stale != NULL)
+      stale->valid = false;
+
+    slot->disk_sector = sector;
+    slot->delayed = false;
+    delayed_cnt--;
+  }
+
+  lock_release (&bc_lock);
+  return slot != NULL;
+}
+
+/* Discards every delayed block of the inode at sector OWNER. */
+void
+bc_drop_delayed (block_sector_t owner)
+{
+  lock_acquire (&bc_lock);
+
+  for (size_t i = 0; i < bc_cnt; i++)
+    if (cache[i].valid == true && cache[i].delayed == true
+        && cache[i].owner == owner) {
+      cache[i].valid = false;
+      cache[i].delayed = false;
+      delayed_cnt--;
+    }
+
+  lock_release (&bc_lock);
+}
+
 void
 bc_flush (struct bc_entry_t *entry)
 {
@@ -69,13 +424,43 @@ bc_flush (struct bc_entry_t *entry)
   entry->dirty = false;
 }
 
+/* Writes back the dirty slots that belong to the inode at sector
+   OWNER, leaving the rest of the cache alone. */
+void
+bc_flush_inode (block_sector_t owner)
+{
+  lock_acquire (&bc_lock);
+
+  for (size_t i = 0; i < bc_cnt; i++)
+    if (cache[i].valid == true && cache[i].dirty == true
+        && cache[i].delayed == false && cache[i].owner == owner)
+      bc_flush(&(cache[i]));
+
+  lock_release (&bc_lock);
+}
+
+/* Writes back SECTOR if the cache holds it dirty, whichever inode
+   it was last recorded for. */
+void
+bc_flush_sector (block_sector_t sector)
+{
+  lock_acquire (&bc_lock);
+
+  struct bc_entry_t *slot = bc_lookup (sector);
+  if (slot != NULL && slot->dirty == true)
+    bc_flush (slot);
+
+  lock_release (&bc_lock);
+}
+
 void
 bc_flush_all (void)
 {
   lock_acquire (&bc_lock);
 
-  for (size_t i = 0; i < BUFFER_CACHE_SIZE; i++)
-    if (cache[i].valid == true && cache[i].dirty == true)
+  for (size_t i = 0; i < bc_cnt; i++)
+    if (cache[i].valid == true && cache[i].dirty == true
+        && cache[i].delayed == false)
       bc_flush(&(cache[i]));
   
   lock_release (&bc_lock);
@@ -84,27 +469,71 @@ bc_flush_all (void)
 struct bc_entry_t*
 bc_lookup (block_sector_t sector)
 {
-  for (size_t i = 0; i < BUFFER_CACHE_SIZE; ++ i)
-    if (cache[i].valid == true && cache[i].disk_sector == sector) 
+  for (size_t i = 0; i < bc_cnt; ++ i)
+    if (cache[i].valid == true && cache[i].delayed == false
+        && cache[i].disk_sector == sector) 
+      return &(cache[i]);
+  return NULL;
+}
+
+static struct bc_entry_t *
+bc_lookup_delayed (block_sector_t owner, off_t index)
+{
+  for (size_t i = 0; i < bc_cnt; ++ i)
+    if (cache[i].valid == true && cache[i].delayed == true
+        && cache[i].owner == owner && cache[i].index == index)
       return &(cache[i]);
   return NULL;
 }
 
+/* Sets how many metadata slots data traffic must leave in the
+   cache, at most what the smallest cache can spare. */
+void
+bc_set_meta_floor (size_t floor)
+{
+  size_t max = BUFFER_CACHE_SIZE - BC_DELAYED_MAX - 2;
+  bc_meta_floor = floor < max ? floor : max;
+}
+
+/* Frees a slot for a block that is metadata if META, otherwise
+   data, evicting one if none is free.  Data may only evict
+   metadata slots while there are more than bc_meta_floor. */
 struct bc_entry_t*
-bc_select_victim (void)
+bc_select_victim (bool meta)
 {
-  uint8_t clock = 0;
+  size_t clock = 0;
+  size_t meta_cnt = 0;
+
+  for (size_t i = 0; i < bc_cnt; i++)
+    if (cache[i].valid == false)
+      return &(cache[i]);
+
+  //rather than evict, take spare memory while there is some
+  if (bc_grow ())
+    return &(cache[bc_cnt - SLOTS_PER_PAGE]);
+
+  if (!meta)
+    for (size_t i = 0; i < bc_cnt; i++)
+      if (cache[i].meta == true)
+        meta_cnt++;
+  bool spare_meta = meta || meta_cnt > bc_meta_floor;
+
+  if (delayed_cnt >= BC_DELAYED_MAX / 2)
+    delayed_pressure = true;
 
   while (true) {
     if (cache[clock].valid == false) 
       return &(cache[clock]);
 
-    if (cache[clock].access == false) break;
-    
-    cache[clock].access = false;
+    if (cache[clock].pinned == false && cache[clock].delayed == false
+        && (spare_meta || cache[clock].meta == false)) {
+      if (cache[clock].access == false) break;
+
+      cache[clock].access = false;
+    }
 
     clock++;
-    clock %= BUFFER_CACHE_SIZE;
+    clock %= bc_cnt;
   }
 
   if(cache[clock].dirty == true)
@@ -112,4 +541,73 @@ bc_select_victim (void)
   cache[clock].valid = false;
 
   return &(cache[clock]);
-}
\ No newline at end of file
+}
+
+/* Adds a page of slots to the cache, if it is below BC_MAX_SIZE
+   and the user pool has a free page without shrinking anything.
+   With VM, only memory above kswapd's high watermark is spare, so
+   that growing never makes kswapd evict process pages.  Must be
+   called with bc_lock held. */
+static bool
+bc_grow (void)
+{
+  uint8_t *page;
+
+  if (bc_cnt + SLOTS_PER_PAGE > BC_MAX_SIZE)
+    return false;
+#ifdef VM
+  if (palloc_user_free () <= frame_high_watermark ())
+    return false;
+#endif
+  page = palloc_get_page (PAL_USER | PAL_NOSHRINK);
+  if (page == NULL)
+    return false;
+
+  for (size_t i = 0; i < SLOTS_PER_PAGE; i++) {
+    struct bc_entry_t *slot = &cache[bc_cnt + i];
+    slot->buffer = page + i * BLOCK_SECTOR_SIZE;
+    slot->valid = false;
+    slot->dirty = false;
+    slot->access = false;
+    slot->pinned = false;
+    slot->delayed = false;
+    slot->meta = false;
+  }
+  bc_cnt += SLOTS_PER_PAGE;
+  return true;
+}
+
+/* Shrinker for the user pool: writes back and gives up the most
+   recently added pages of slots, down to BUFFER_CACHE_SIZE.  A page
+   holding a delayed block stays, since that block is nowhere else. */
+static size_t
+bc_shrink (size_t page_cnt)
+{
+  size_t freed = 0;
+
+  if (lock_held_by_current_thread (&bc_lock) || !lock_try_acquire (&bc_lock))
+    return 0;
+
+  while (freed < page_cnt && bc_cnt > BUFFER_CACHE_SIZE) {
+    struct bc_entry_t *slots = &cache[bc_cnt - SLOTS_PER_PAGE];
+    size_t i;
+
+    for (i = 0; i < SLOTS_PER_PAGE; i++)
+      if (slots[i].valid == true && slots[i].delayed == true)
+        break;
+    if (i < SLOTS_PER_PAGE)
+      break;
+
+    for (i = 0; i < SLOTS_PER_PAGE; i++) {
+      if (slots[i].valid == true && slots[i].dirty == true)
+        bc_flush (&slots[i]);
+      slots[i].valid = false;
+    }
+    palloc_free_page (slots[0].buffer);
+    bc_cnt -= SLOTS_PER_PAGE;
+    freed++;
+  }
+
+  lock_release (&bc_lock);
+  return freed;
+}
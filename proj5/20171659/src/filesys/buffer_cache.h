@@ -2,28 +2,64 @@
 #define FILESYS_BUFFER_CACHE_H
 
 #include "devices/block.h"
+#include "filesys/off_t.h"
 #include "threads/synch.h"
 
+/* Slots the cache always has.  It grows past this, a page of
+   slots at a time, while the user pool has pages to spare, and
+   gives them back when the pool runs short. */
 #define BUFFER_CACHE_SIZE 64
+#define BC_MAX_SIZE 512
+/* Most slots that may hold delayed-allocation blocks at once. */
+#define BC_DELAYED_MAX (BUFFER_CACHE_SIZE / 2)
+/* Default number of metadata slots that data cannot evict. */
+#define BC_META_FLOOR 16
 
 struct bc_entry_t {
   block_sector_t disk_sector;
-  uint8_t buffer[BLOCK_SECTOR_SIZE];
+  block_sector_t owner;     // inode sector of the file this slot belongs to
+  uint8_t *buffer;
 
   bool valid;     // valid bit
   bool dirty;     // dirty bit
   bool access;    // access bit
+  bool pinned;    // pinned bit, never chosen as victim
+  bool delayed;   // no disk sector yet, keyed by (owner, index)
+  bool meta;      // inode, index or directory block
+  off_t index;    // block index within owner, if delayed
 };
 
-struct bc_entry_t cache[BUFFER_CACHE_SIZE];
+struct bc_entry_t cache[BC_MAX_SIZE];
 struct lock bc_lock;
 
 void bc_init (void);
 void bc_read (block_sector_t sector, void *target);
-void bc_write (block_sector_t sector, const void *source);
+void bc_read_meta (block_sector_t sector, void *target);
+void bc_write (block_sector_t sector, const void *source, block_sector_t owner);
+void bc_write_meta (block_sector_t sector, const void *source,
+                    block_sector_t owner);
+void bc_write_at (block_sector_t sector, int ofs, const void *source,
+                  int size, block_sector_t owner);
+bool bc_take (block_sector_t sector, void *target);
+void bc_read_around (block_sector_t sector, void *target);
+void bc_write_around (block_sector_t sector, const void *source,
+                      block_sector_t owner);
+void bc_copy (block_sector_t dst, int dst_ofs,
+              block_sector_t src, int src_ofs, int size, block_sector_t owner);
+size_t bc_delayed_room (void);
+bool bc_delayed_pressure (void);
+void bc_read_delayed (block_sector_t owner, off_t index, void *target);
+bool bc_write_delayed (block_sector_t owner, off_t index, int ofs,
+                       const void *source, int size);
+bool bc_assign_delayed (block_sector_t owner, off_t index,
+                        block_sector_t sector);
+void bc_drop_delayed (block_sector_t owner);
 void bc_flush (struct bc_entry_t *entry);
+void bc_flush_inode (block_sector_t owner);
+void bc_flush_sector (block_sector_t sector);
 void bc_flush_all (void);
 struct bc_entry_t* bc_lookup (block_sector_t sector);
-struct bc_entry_t* bc_select_victim (void);
+struct bc_entry_t* bc_select_victim (bool meta);
+void bc_set_meta_floor (size_t floor);
 
 #endif
@@ -9,8 +9,11 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    bool direct;                /* Bypass the buffer cache? */
   };
 
+static bool is_direct (const struct file *, off_t size, off_t ofs);
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
@@ -23,6 +26,7 @@ file_open (struct inode *inode)
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
+      file->direct = false;
       return file;
     }
   else
@@ -41,6 +45,23 @@ file_reopen (struct file *file)
   return file_open (inode_reopen (file->inode));
 }
 
+/* Opens and returns a new file for the same inode as FILE, at the
+   same position and with the same flags, for a forked process.
+   Returns a null pointer if unsuccessful. */
+struct file *
+file_duplicate (struct file *file)
+{
+  struct file *copy = file_reopen (file);
+  if (copy != NULL)
+    {
+      copy->pos = file->pos;
+      copy->direct = file->direct;
+      if (file->deny_write)
+        file_deny_write (copy);
+    }
+  return copy;
+}
+
 /* Closes FILE. */
 void
 file_close (struct file *file)
@@ -68,7 +89,7 @@ file_get_inode (struct file *file)
 off_t
 file_read (struct file *file, void *buffer, off_t size)
 {
-  off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  off_t bytes_read = file_read_at (file, buffer, size, file->pos);
   file->pos += bytes_read;
   return bytes_read;
 }
@@ -81,6 +102,8 @@ file_read (struct file *file, void *buffer, off_t size)
 off_t
 file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 {
+  if (is_direct (file, size, file_ofs))
+    return inode_read_direct (file->inode, buffer, size, file_ofs);
   return inode_read_at (file->inode, buffer, size, file_ofs);
 }
 
@@ -94,7 +117,7 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 off_t
 file_write (struct file *file, const void *buffer, off_t size)
 {
-  off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+  off_t bytes_written = file_write_at (file, buffer, size, file->pos);
   file->pos += bytes_written;
   return bytes_written;
 }
@@ -110,9 +133,74 @@ off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
                off_t file_ofs)
 {
+  if (is_direct (file, size, file_ofs))
+    return inode_write_direct (file->inode, buffer, size, file_ofs);
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies SIZE bytes from SRC's current position to DST's current
+   position without passing the data through a caller's buffer.
+   Returns the number of bytes actually copied, which may be less
+   than SIZE if end of SRC is reached.
+   Advances both files' positions by the number of bytes copied. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size)
+{
+  off_t bytes_copied = inode_copy_at (dst->inode, dst->pos,
+                                      src->inode, src->pos, size);
+  src->pos += bytes_copied;
+  dst->pos += bytes_copied;
+  return bytes_copied;
+}
+
+/* Preallocates the SIZE bytes of FILE starting at offset START,
+   extending FILE if they reach past its end, without changing the
+   current position.  Returns true if successful, false if writes
+   to FILE are denied or the disk is full. */
+bool
+file_allocate (struct file *file, off_t start, off_t size)
+{
+  ASSERT (file != NULL);
+  return inode_fallocate (file->inode, start, size);
+}
+
+/* Sets the length of FILE to LENGTH bytes, either zero-filling it
+   or cutting off its tail.  Returns false if writes to FILE are
+   denied or the disk or memory runs out. */
+bool
+file_truncate (struct file *file, off_t length)
+{
+  ASSERT (file != NULL);
+  return inode_truncate (file->inode, length);
+}
+
+/* Turns direct I/O on or off for FILE.  While it is on, reads and
+   writes whose offset and size are whole sectors go between the
+   disk and the caller without filling the buffer cache. */
+void
+file_set_direct (struct file *file, bool direct)
+{
+  ASSERT (file != NULL);
+  file->direct = direct;
+}
+
+/* Returns true if a transfer of SIZE bytes at OFS in FILE should
+   bypass the buffer cache. */
+static bool
+is_direct (const struct file *file, off_t size, off_t ofs)
+{
+  return (file->direct
+          && ofs % BLOCK_SECTOR_SIZE == 0 && size % BLOCK_SECTOR_SIZE == 0);
+}
+
+/* Writes FILE's cached data and metadata back to disk. */
+void
+file_sync (struct file *file)
+{
+  ASSERT (file != NULL);
+  inode_sync (file->inode);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
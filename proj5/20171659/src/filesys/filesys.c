@@ -8,6 +8,9 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#ifdef VM
+#include "vm/page_cache.h"
+#endif
 
 /* Partition that contains the file system. */
 struct block *fs_device;
@@ -15,20 +18,21 @@ struct block *fs_device;
 static void do_format (void);
 
 /* Initializes the file system module.
-   If FORMAT is true, reformats the file system. */
+   If FORMAT is true, reformats the file system, with a compact
+   inode table if COMPACT_INODES is true. */
 void
-filesys_init (bool format)
+filesys_init (bool format, bool compact_inodes)
 {
   fs_device = block_get_role (BLOCK_FILESYS);
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
-  inode_init ();
-  free_map_init ();
-  
   /*modified5 : buffer cache */
   bc_init ();
 
+  inode_init (format, compact_inodes);
+  free_map_init ();
+
   if (format)
     do_format ();
 
@@ -40,12 +44,30 @@ filesys_init (bool format)
 void
 filesys_done (void)
 {
+#ifdef VM
+  pcache_flush_all ();
+#endif
+  /* modified5 : delayed allocation */
+  inode_commit_all ();
+  inode_reclaim_wait ();
   free_map_close ();
 
   /*modified5 : buffer cache */
   bc_flush_all ();
 }
 
+/* Writes every dirty block in the buffer cache to disk, along
+   with dirty pages of the page cache. */
+void
+filesys_sync (void)
+{
+#ifdef VM
+  pcache_flush_all ();
+#endif
+  inode_commit_all ();
+  bc_flush_all ();
+}
+
 /* Creates a file named NAME with the given INITIAL_SIZE.
    Returns true if successful, false otherwise.
    Fails if a file named NAME already exists,
@@ -64,12 +86,12 @@ filesys_create (const char *path, off_t initial_size, bool is_dir)
   struct dir *dir = dir_open_path(directory);
 
   bool success = false;
-  if(dir != NULL && free_map_allocate(1, &inode_sector) && inode_create(inode_sector, initial_size, is_dir)
+  if(dir != NULL && inumber_allocate(&inode_sector) && inode_create(inode_sector, initial_size, is_dir)
       && dir_add (dir, file_name, inode_sector, is_dir)) 
       success = true; 
   
   if (!success && inode_sector != 0)
-    free_map_release (inode_sector, 1);
+    inumber_release (inode_sector);
   dir_close (dir);
 
   return success;
@@ -12,8 +12,9 @@
 struct block *fs_device;
 
 /* modified5 : path handling */
-void filesys_init (bool format);
+void filesys_init (bool format, bool compact_inodes);
 void filesys_done (void);
+void filesys_sync (void);
 bool filesys_create (const char *name, off_t initial_size, bool is_dir);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
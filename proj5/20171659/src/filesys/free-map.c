@@ -4,39 +4,74 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static struct lock free_map_lock;    /* Guards all of the above, since
+                                        the reclaimer thread frees
+                                        sectors behind callers' backs. */
+static size_t reserved_cnt;          /* Free sectors promised to
+                                        delayed allocations. */
+static bool deferred;                /* Hold bitmap writes until
+                                        free_map_flush()? */
+static bool dirty;                   /* Changed since last written? */
+
+static bool allocate (size_t cnt, block_sector_t *sectorp);
+static bool reserve (size_t cnt);
+static bool free_map_write (void);
 
 /* Initializes the free map. */
 void
 free_map_init (void)
 {
+  lock_init (&free_map_lock);
   free_map = bitmap_create (block_size (fs_device));
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, 0, inode_table_sectors (), true);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
    the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available, if the only free sectors are reserved,
+   or if the free_map file could not be written.  Sectors still
+   waiting for the reclaimer thread are freed first if that makes
+   the difference. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
+  return (allocate (cnt, sectorp)
+          || (inode_reclaim_wait () && allocate (cnt, sectorp)));
+}
+
+/* Does one attempt of free_map_allocate(). */
+static bool
+allocate (size_t cnt, block_sector_t *sectorp)
+{
+  lock_acquire (&free_map_lock);
+  if (reserved_cnt > 0
+      && bitmap_count (free_map, 0, bitmap_size (free_map), false)
+         < reserved_cnt + cnt)
+    {
+      lock_release (&free_map_lock);
+      return false;
+    }
+
   block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+      && !free_map_write ())
     {
       bitmap_set_multiple (free_map, sector, cnt, false);
       sector = BITMAP_ERROR;
     }
   if (sector != BITMAP_ERROR)
     *sectorp = sector;
+  lock_release (&free_map_lock);
   return sector != BITMAP_ERROR;
 }
 
@@ -44,9 +79,116 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  free_map_write ();
+  lock_release (&free_map_lock);
+}
+
+/* Makes the CNT sectors listed in SECTORS available for use,
+   writing the free map only once. */
+void
+free_map_release_list (const block_sector_t sectors[], size_t cnt)
+{
+  size_t i;
+
+  lock_acquire (&free_map_lock);
+  for (i = 0; i < cnt; i++)
+    {
+      ASSERT (bitmap_test (free_map, sectors[i]));
+      bitmap_reset (free_map, sectors[i]);
+    }
+  free_map_write ();
+  lock_release (&free_map_lock);
+}
+
+/* Writes the free map to its file, or only notes that it needs
+   writing while writes are deferred. */
+static bool
+free_map_write (void)
+{
+  if (deferred)
+    {
+      dirty = true;
+      return true;
+    }
+  dirty = false;
+  return bitmap_write (free_map, free_map_file);
+}
+
+/* Stops writing the free map to its file on every change, for
+   bulk work that allocates many sectors.  free_map_flush() writes
+   it once and ends deferral. */
+void
+free_map_defer (void)
+{
+  lock_acquire (&free_map_lock);
+  deferred = true;
+  lock_release (&free_map_lock);
+}
+
+/* Writes the free map if it changed while writes were deferred,
+   and resumes writing on every change.  Returns false if the
+   free map file could not be written. */
+bool
+free_map_flush (void)
+{
+  bool success;
+
+  lock_acquire (&free_map_lock);
+  deferred = false;
+  success = !dirty || free_map_write ();
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Sets aside CNT free sectors for a later free_map_allocate()
+   that must not fail, without choosing which ones yet.
+   Returns false if that many sectors are not free, even after
+   the reclaimer thread has freed what it has queued. */
+bool
+free_map_reserve (size_t cnt)
+{
+  return reserve (cnt) || (inode_reclaim_wait () && reserve (cnt));
+}
+
+/* Does one attempt of free_map_reserve(). */
+static bool
+reserve (size_t cnt)
+{
+  bool success;
+
+  lock_acquire (&free_map_lock);
+  success = (bitmap_count (free_map, 0, bitmap_size (free_map), false)
+             >= reserved_cnt + cnt);
+  if (success)
+    reserved_cnt += cnt;
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Returns CNT reserved sectors to the general pool, normally just
+   before allocating them. */
+void
+free_map_unreserve (size_t cnt)
+{
+  lock_acquire (&free_map_lock);
+  ASSERT (reserved_cnt >= cnt);
+  reserved_cnt -= cnt;
+  lock_release (&free_map_lock);
+}
+
+/* Stores the number of sectors marked in use in *USED_CNT and the
+   number of free sectors promised to delayed allocations in
+   *RESERVED_CNT. */
+void
+free_map_stat (size_t *used_cnt, size_t *reserved_cntp)
+{
+  lock_acquire (&free_map_lock);
+  *used_cnt = bitmap_count (free_map, 0, bitmap_size (free_map), true);
+  *reserved_cntp = reserved_cnt;
+  lock_release (&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -64,6 +206,7 @@ free_map_open (void)
 void
 free_map_close (void)
 {
+  free_map_flush ();
   file_close (free_map_file);
 }
 
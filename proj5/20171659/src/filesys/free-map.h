@@ -13,5 +13,11 @@ void free_map_close (void);
 
 bool free_map_allocate (size_t, block_sector_t *);
 void free_map_release (block_sector_t, size_t);
+void free_map_release_list (const block_sector_t[], size_t);
+bool free_map_reserve (size_t);
+void free_map_unreserve (size_t);
+void free_map_stat (size_t *, size_t *);
+void free_map_defer (void);
+bool free_map_flush (void);
 
 #endif /* filesys/free-map.h */
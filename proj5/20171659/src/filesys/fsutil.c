@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,6 +8,7 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/free-map.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -67,6 +69,12 @@ fsutil_rm (char **argv)
     PANIC ("%s: delete failed\n", file_name);
 }
 
+/* Sectors of file data that fsutil_extract() and fsutil_append()
+   move between the archive and the file system at a time, in one
+   transfer on the scratch device. */
+#define CHUNK_SECTORS 64
+#define CHUNK_SIZE (CHUNK_SECTORS * BLOCK_SECTOR_SIZE)
+
 /* Extracts a ustar-format tar archive from the scratch block
    device into the Pintos file system. */
 void
@@ -75,11 +83,12 @@ fsutil_extract (char **argv UNUSED)
   static block_sector_t sector = 0;
 
   struct block *src;
-  void *header, *data;
+  void *header;
+  uint8_t *data;
 
   /* Allocate buffers. */
   header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
+  data = malloc (CHUNK_SIZE);
   if (header == NULL || data == NULL)
     PANIC ("couldn't allocate buffers");
 
@@ -91,6 +100,9 @@ fsutil_extract (char **argv UNUSED)
   printf ("Extracting ustar archive from scratch device "
           "into file system...\n");
 
+  /* Write the free map and cached metadata once, at the end. */
+  free_map_defer ();
+
   for (;;)
     {
       const char *file_name;
@@ -117,7 +129,8 @@ fsutil_extract (char **argv UNUSED)
 
           printf ("Putting '%s' into the file system...\n", file_name);
 
-          /* Create destination file. */
+          /* Create destination file, which also lays out its
+             sectors contiguously. */
           /* modified5 : change parameter for directory handling */
           if (!filesys_create (file_name, size, false))
             PANIC ("%s: create failed", file_name);
@@ -125,13 +138,17 @@ fsutil_extract (char **argv UNUSED)
           if (dst == NULL)
             PANIC ("%s: open failed", file_name);
 
-          /* Do copy. */
+          /* Do copy, a run of sectors at a time. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
+              int chunk_size = (size > CHUNK_SIZE
+                                ? CHUNK_SIZE
                                 : size);
-              block_read (src, sector++, data);
+              size_t chunk_sectors = DIV_ROUND_UP (chunk_size,
+                                                   BLOCK_SECTOR_SIZE);
+
+              block_read_run (src, sector, chunk_sectors, data);
+              sector += chunk_sectors;
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
@@ -143,6 +160,10 @@ fsutil_extract (char **argv UNUSED)
         }
     }
 
+  if (!free_map_flush ())
+    PANIC ("can't write free map");
+  filesys_sync ();
+
   /* Erase the ustar header from the start of the block device,
      so that the extraction operation is idempotent.  We erase
      two blocks because two blocks of zeros are the ustar
@@ -178,7 +199,7 @@ fsutil_append (char **argv)
   printf ("Appending '%s' to ustar archive on scratch device...\n", file_name);
 
   /* Allocate buffer. */
-  buffer = malloc (BLOCK_SECTOR_SIZE);
+  buffer = malloc (CHUNK_SIZE);
   if (buffer == NULL)
     PANIC ("couldn't allocate buffer");
 
@@ -198,16 +219,19 @@ fsutil_append (char **argv)
     PANIC ("%s: name too long for ustar format", file_name);
   block_write (dst, sector++, buffer);
 
-  /* Do copy. */
+  /* Do copy, a run of sectors at a time. */
   while (size > 0)
     {
-      int chunk_size = size > BLOCK_SECTOR_SIZE ? BLOCK_SECTOR_SIZE : size;
-      if (sector >= block_size (dst))
+      int chunk_size = size > CHUNK_SIZE ? CHUNK_SIZE : size;
+      size_t chunk_sectors = DIV_ROUND_UP (chunk_size, BLOCK_SECTOR_SIZE);
+      if (sector + chunk_sectors > block_size (dst))
         PANIC ("%s: out of space on scratch device", file_name);
       if (file_read (src, buffer, chunk_size) != chunk_size)
         PANIC ("%s: read failed with %"PROTd" bytes unread", file_name, size);
-      memset (buffer + chunk_size, 0, BLOCK_SECTOR_SIZE - chunk_size);
-      block_write (dst, sector++, buffer);
+      memset (buffer + chunk_size, 0,
+              chunk_sectors * BLOCK_SECTOR_SIZE - chunk_size);
+      block_write_run (dst, sector, chunk_sectors, buffer);
+      sector += chunk_sectors;
       size -= chunk_size;
     }
 
@@ -1,4 +1,5 @@
 #include "filesys/inode.h"
+#include <bitmap.h>
 #include <list.h>
 #include <debug.h>
 #include <round.h>
@@ -6,42 +7,184 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "filesys/buffer_cache.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page_cache.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Ticks after which writes give delayed blocks their sectors. */
+#define DELAYED_EXPIRE (5 * TIMER_FREQ)
+
 #define DIRECT_BLOCKS 123
 #define INDIRECT_BLOCKS 1
 #define DOUBLE_INDIRECT_BLOCKS 1
 #define INDIRECT_BLOCKS_PER_SECTOR 128
 
+/* Most data sectors a single inode can address. */
+#define MAX_DATA_SECTORS (DIRECT_BLOCKS                                 \
+                          + INDIRECT_BLOCKS * INDIRECT_BLOCKS_PER_SECTOR \
+                          + DOUBLE_INDIRECT_BLOCKS                      \
+                            * INDIRECT_BLOCKS_PER_SECTOR                \
+                            * INDIRECT_BLOCKS_PER_SECTOR)
+
+/* Set in a data block pointer whose sector was preallocated but
+   never written.  Such a block reads back as zeros without any
+   disk I/O. */
+#define SECTOR_UNWRITTEN 0x80000000u
+
+/* Identifies a used slot of a compact inode table, and the slot
+   describing the table itself. */
+#define INODE_COMPACT_MAGIC 0x494e4f43
+#define INODE_TABLE_MAGIC 0x494e5442
+
+/* On-disk inodes per sector of a compact inode table. */
+#define INODES_PER_SECTOR 4
+
+/* A compact inode table is made with one inode for every this many
+   sectors of the file system device. */
+#define INODE_RATIO 8
+
+/* The table describes itself in the last slot of sector 0, which
+   puts its magic number where a one-inode-per-sector file system
+   keeps that of the free map inode. */
+#define INODE_TABLE_INUMBER (INODES_PER_SECTOR - 1)
+
+/* Files no longer than this fit in a compact inode. */
+#define COMPACT_INLINE_MAX 116
+
+/* Most closed inodes kept in memory for a later reopen. */
+#define INODE_CACHE_SIZE 64
+
+/* Most roots in one reclaim job: every direct block, or the
+   pointers past a cut in two index blocks, plus the index blocks
+   themselves. */
+#define RECLAIM_ROOTS (DIRECT_BLOCKS + 2 * INDIRECT_BLOCKS_PER_SECTOR + 2)
+
+/* Most sectors the reclaimer frees between two yields, enough for
+   a full index block and the data it points to. */
+#define RECLAIM_BATCH (INDIRECT_BLOCKS_PER_SECTOR + 1)
+
+/* Files no longer than this keep their data inside the inode
+   sector, in place of the block pointers. */
+#define INLINE_DATA_MAX ((DIRECT_BLOCKS + 2) * sizeof (block_sector_t))
+
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 /*modified5 : file system */
 struct inode_disk
   {
-    /** Data sectors */
-    block_sector_t direct_blocks[DIRECT_BLOCKS];
-    block_sector_t indirect_block;
-    block_sector_t doubly_indirect_block;
+    union
+      {
+        /** Data sectors */
+        struct
+          {
+            block_sector_t direct_blocks[DIRECT_BLOCKS];
+            block_sector_t indirect_block;
+            block_sector_t doubly_indirect_block;
+          };
+        /** File data itself, if is_inline. */
+        uint8_t inline_data[INLINE_DATA_MAX];
+      };
 
     bool is_dir;
+    bool is_inline;                     /* Data stored in inline_data. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
     //uint32_t unused[125];               /* Not used. */
   };
 
+/* On-disk inode in a compact inode table, INODES_PER_SECTOR to a
+   sector.  An inode whose data is not inline keeps a full
+   inode_disk in a sector of its own, INDEX_SECTOR. */
+struct inode_compact
+  {
+    union
+      {
+        uint8_t inline_data[COMPACT_INLINE_MAX];
+        block_sector_t index_sector;
+      };
+    off_t length;                       /* File size in bytes. */
+    bool is_dir;
+    bool is_inline;                     /* Data stored in inline_data. */
+    unsigned magic;                     /* Magic number. */
+  };
+
 struct inode_indirect_block {
   block_sector_t blocks[INDIRECT_BLOCKS_PER_SECTOR];
 };
 
+/* Blocks cut off a removed or truncated file, which the reclaimer
+   thread gives back to the free map a batch at a time.  Nothing
+   points at them any more, so no lock protects them. */
+struct reclaim_job
+  {
+    struct list_elem elem;              /* Element in reclaim_jobs. */
+    size_t root_cnt;                    /* Roots left to free. */
+    struct
+      {
+        block_sector_t sector;          /* Data or index block. */
+        size_t cnt;                     /* Data blocks the index block
+                                           points to, 0 for a data
+                                           block. */
+      }
+    roots[RECLAIM_ROOTS];
+  };
+
 /* modified5 : file system */
 static block_sector_t index_to_sector (const struct inode_disk *idisk, off_t index);
-static bool inode_allocate (struct inode_disk *disk_inode, off_t length);
-static bool inode_allocate_indirect (block_sector_t* p_entry, size_t num_sectors, int level);
+static bool inode_allocate (struct inode_disk *disk_inode, off_t length, block_sector_t owner);
+static bool inode_allocate_indirect (block_sector_t* p_entry, size_t num_sectors, int level, block_sector_t owner);
+static bool inode_grow (struct inode *inode, off_t length);
+static bool inode_extend (struct inode *inode, off_t length);
+static bool inode_commit (struct inode *inode);
+static size_t inode_reserved (const struct inode *inode);
+static void inode_drop_delayed (struct inode *inode);
+static bool inode_uninline (struct inode *inode);
+static bool inode_preallocate (struct inode_disk *idisk, off_t length,
+                               block_sector_t owner);
+static block_sector_t inode_mark_written (struct inode *inode,
+                                          off_t block_index, bool zero);
+static bool index_set_sector (struct inode_disk *idisk, off_t index,
+                              block_sector_t sector, block_sector_t owner);
+static uint8_t *cached_byte (struct inode *inode, off_t offset, bool write);
 static void inode_free (struct inode *inode);
+static struct inode *inode_cache_find (block_sector_t sector);
+static size_t inode_cache_drop (size_t cnt);
+static size_t inode_cache_shrink (size_t page_cnt);
+static size_t inline_max (void);
+static void inode_table_format (void);
+static void inode_table_mount (void);
+static block_sector_t inode_table_sector (block_sector_t inumber);
+static int inode_table_offset (block_sector_t inumber);
+static void inode_load (struct inode *inode);
+static void inode_store (block_sector_t inumber,
+                         const struct inode_disk *idisk,
+                         block_sector_t index_sector);
+static void inode_save (struct inode *inode);
+static void data_read (const struct inode *inode, block_sector_t sector,
+                       void *buffer);
+static void data_write (const struct inode *inode, block_sector_t sector,
+                        const void *buffer);
 static void inode_free_indirect (block_sector_t entry, size_t num_sectors, int level);
+static void reclaim_cut (struct inode_disk *idisk, size_t first,
+                         struct reclaim_job *job, block_sector_t owner);
+static void reclaim_cut_block (block_sector_t sector, size_t first,
+                               size_t cnt, struct reclaim_job *job,
+                               block_sector_t owner);
+static void reclaim_add (struct reclaim_job *job, block_sector_t sector,
+                         size_t cnt);
+static void reclaim_queue (struct reclaim_job *job);
+static void reclaim_step (struct reclaim_job *job);
+static thread_func reclaim_thread NO_RETURN;
 
 static inline size_t
 min (size_t a, size_t b)
@@ -65,7 +208,13 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    off_t length;                       /* Length, counting blocks past
+                                           data.length that are held in
+                                           the buffer cache awaiting
+                                           allocation. */
     struct inode_disk data;             /* Inode content. */
+    block_sector_t index_sector;        /* Sector holding DATA in a
+                                           compact inode table, or 0. */
     /* modified5 : file system */
     //struct lock extend_lock; 
   };
@@ -79,7 +228,8 @@ byte_to_sector (const struct inode *inode, off_t pos)
 {
   ASSERT (inode != NULL);
   /* modified5 : file system */
-  if (0 <= pos && pos < inode->data.length) {
+  if (0 <= pos
+      && (size_t) (pos / BLOCK_SECTOR_SIZE) < bytes_to_sectors (inode->data.length)) {
     off_t block_index = pos / BLOCK_SECTOR_SIZE;
     return index_to_sector (&inode->data, block_index);
   }
@@ -91,11 +241,58 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
-/* Initializes the inode module. */
+/* Inodes nobody has open any more, most recently closed first.
+   They are in sync with the disk, so reopening one needs no I/O
+   and dropping one needs no writeback. */
+static struct list closed_inodes;
+static size_t closed_cnt;
+static struct lock closed_lock;         /* Guards the two above. */
+
+/* Jobs for the reclaimer thread, oldest first.  A job stays at
+   the front while the reclaimer works on it. */
+static struct list reclaim_jobs;
+static struct lock reclaim_lock;        /* Guards reclaim_jobs. */
+static struct condition reclaim_ready;  /* Signaled when a job is queued. */
+static struct condition reclaim_idle;   /* Signaled when none are left. */
+
+/* Open inodes with delayed blocks, and when the first of them got
+   its first one. */
+static size_t delayed_inode_cnt;
+static int64_t delayed_since;
+
+/* Gives cached inodes back when the kernel pool runs out. */
+static struct shrinker inode_shrinker = { .shrink = inode_cache_shrink };
+
+/* Whether inodes live in a compact inode table at the start of
+   the device, rather than one to a sector anywhere on it.  In a
+   compact table an inode number is a slot index, not a sector. */
+static bool compact;
+static size_t table_cnt;                /* Sectors in the table. */
+static struct bitmap *inode_map;        /* Used slots of the table. */
+
+/* Initializes the inode module.  If FORMAT is true the device is
+   about to be formatted, with a compact inode table if
+   COMPACT_TABLE; otherwise the layout is read from the device. */
 void
-inode_init (void)
+inode_init (bool format, bool compact_table)
 {
   list_init (&open_inodes);
+  list_init (&closed_inodes);
+  closed_cnt = 0;
+  lock_init (&closed_lock);
+  palloc_register_shrinker (&inode_shrinker);
+
+  list_init (&reclaim_jobs);
+  lock_init (&reclaim_lock);
+  cond_init (&reclaim_ready);
+  cond_init (&reclaim_idle);
+  thread_create ("reclaim", PRI_DEFAULT, reclaim_thread, NULL);
+
+  compact = format ? compact_table : false;
+  if (format && compact)
+    inode_table_format ();
+  else if (!format)
+    inode_table_mount ();
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -107,6 +304,7 @@ bool
 inode_create (block_sector_t sector, off_t length, bool is_dir)
 {
   struct inode_disk *disk_inode = NULL;
+  block_sector_t index_sector = 0;
   bool success = false;
 
   ASSERT (length >= 0);
@@ -118,14 +316,25 @@ inode_create (block_sector_t sector, off_t length, bool is_dir)
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      disk_inode->length = length;
       disk_inode->magic = INODE_MAGIC;
       /* modified5 : directory */
       disk_inode->is_dir = is_dir;
-      if(inode_allocate (disk_inode, disk_inode->length)){
-        bc_write (sector, disk_inode); //buffer cache
+      /* Small files start out inline and need no data sectors. */
+      disk_inode->is_inline = (size_t) length <= inline_max ();
+      if (disk_inode->is_inline)
+        disk_inode->length = length;
+      /* Larger ones get unwritten sectors instead of zeroed ones,
+         and in a compact table a sector for the block pointers. */
+      if (disk_inode->is_inline)
         success = true;
-      }
+      else if (!compact || free_map_allocate (1, &index_sector))
+        {
+          success = inode_preallocate (disk_inode, length, sector);
+          if (!success && compact)
+            free_map_release (index_sector, 1);
+        }
+      if (success)
+        inode_store (sector, disk_inode, index_sector); //buffer cache
       free (disk_inode);
     }
   return success;
@@ -152,23 +361,101 @@ inode_open (block_sector_t sector)
         }
     }
 
-  /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  /* A recently closed inode still has its content in memory. */
+  lock_acquire (&closed_lock);
+  inode = inode_cache_find (sector);
+  if (inode != NULL)
+    {
+      list_remove (&inode->elem);
+      closed_cnt--;
+    }
+  lock_release (&closed_lock);
+
   if (inode == NULL)
-    return NULL;
+    {
+      /* Allocate memory, giving up cached inodes if it is short. */
+      inode = malloc (sizeof *inode);
+      while (inode == NULL && inode_cache_reclaim (1) > 0)
+        inode = malloc (sizeof *inode);
+      if (inode == NULL)
+        return NULL;
+
+      /* modified5 : buffer cache */
+      inode->sector = sector;
+      inode_load (inode);
+      inode->length = inode->data.length;
+    }
 
   /* Initialize. */
   list_push_front (&open_inodes, &inode->elem);
-  inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-
-  /* modified5 : buffer cache */
-  bc_read (inode->sector, &inode->data);
   return inode;
 }
 
+/* Returns the closed inode cached for SECTOR, or a null pointer
+   if there is none. */
+static struct inode *
+inode_cache_find (block_sector_t sector)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&closed_inodes); e != list_end (&closed_inodes);
+       e = list_next (e))
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector)
+        return inode;
+    }
+  return NULL;
+}
+
+/* Frees up to CNT of the least recently closed cached inodes.
+   Returns the number freed. */
+size_t
+inode_cache_reclaim (size_t cnt)
+{
+  size_t freed;
+
+  lock_acquire (&closed_lock);
+  freed = inode_cache_drop (cnt);
+  lock_release (&closed_lock);
+  return freed;
+}
+
+/* Does the work of inode_cache_reclaim() for a caller that holds
+   closed_lock. */
+static size_t
+inode_cache_drop (size_t cnt)
+{
+  size_t freed = 0;
+
+  while (freed < cnt && !list_empty (&closed_inodes))
+    {
+      free (list_entry (list_pop_back (&closed_inodes), struct inode, elem));
+      closed_cnt--;
+      freed++;
+    }
+  return freed;
+}
+
+/* Shrinker for the kernel pool: frees about PAGE_CNT pages' worth
+   of cached inodes. */
+static size_t
+inode_cache_shrink (size_t page_cnt)
+{
+  size_t freed;
+
+  if (lock_held_by_current_thread (&closed_lock)
+      || !lock_try_acquire (&closed_lock))
+    return 0;
+  freed = inode_cache_drop (DIV_ROUND_UP (page_cnt * PGSIZE,
+                                          sizeof (struct inode)));
+  lock_release (&closed_lock);
+  return DIV_ROUND_UP (freed * sizeof (struct inode), PGSIZE);
+}
+
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode)
@@ -201,14 +488,35 @@ inode_close (struct inode *inode)
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
 
-      /* Deallocate blocks if removed. */
+#ifdef VM
+      /* Nothing maps INODE any more, so its cached pages go too. */
+      pcache_evict_inode (inode);
+#endif
+
+      /* Deallocate blocks if removed, otherwise give delayed
+         blocks their sectors now that the final size is known. */
       if (inode->removed)
         {
-          free_map_release (inode->sector, 1);
+          inode_drop_delayed (inode);
+          inumber_release (inode->sector);
+          if (inode->index_sector != 0)
+            free_map_release (inode->index_sector, 1);
           /* modified5 : file system */
           inode_free (inode);
         }
+      else if (inode_commit (inode))
+        {
+          /* Keep it around for the next open of the same sector. */
+          lock_acquire (&closed_lock);
+          list_push_front (&closed_inodes, &inode->elem);
+          if (++closed_cnt > INODE_CACHE_SIZE)
+            inode_cache_drop (closed_cnt - INODE_CACHE_SIZE);
+          lock_release (&closed_lock);
+          return;
+        }
 
+      /* Nowhere left to report the failure. */
+      inode_drop_delayed (inode);
       free (inode);
     }
 }
@@ -232,6 +540,19 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
 
+  /* Inline data is already in memory. */
+  if (inode->data.is_inline)
+    {
+      if (size > inode_length (inode) - offset)
+        size = inode_length (inode) - offset;
+      if (size <= 0)
+        return 0;
+      uint8_t *cached = cached_byte (inode, offset, false);
+      memcpy (buffer, cached != NULL ? cached : inode->data.inline_data + offset,
+              size);
+      return size;
+    }
+
   while (size > 0)
     {
       /* Disk sector to read, starting byte offset within sector. */
@@ -248,10 +569,33 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      uint8_t *cached = cached_byte (inode, offset, false);
+      if (cached != NULL)
+        {
+          /* The page cache has the current copy. */
+          memcpy (buffer + bytes_read, cached, chunk_size);
+        }
+      else if (sector_idx == -1u)
+        {
+          /* Block not allocated yet, it lives only in the cache. */
+          if (bounce == NULL)
+            {
+              bounce = malloc (BLOCK_SECTOR_SIZE);
+              if (bounce == NULL)
+                break;
+            }
+          bc_read_delayed (inode->sector, offset / BLOCK_SECTOR_SIZE, bounce);
+          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+        }
+      else if (sector_idx & SECTOR_UNWRITTEN)
+        {
+          /* Preallocated but never written: all zeros. */
+          memset (buffer + bytes_read, 0, chunk_size);
+        }
+      else if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
           /* modified5 : buffer cache */
-          bc_read (sector_idx, buffer + bytes_read);
+          data_read (inode, sector_idx, buffer + bytes_read);
         }
       else
         {
@@ -265,7 +609,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
             }
 
           /* modified5 : buffer cache */
-          bc_read (sector_idx, bounce);
+          data_read (inode, sector_idx, bounce);
           memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
         }
 
@@ -295,14 +639,29 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   if (inode->deny_write_cnt)
     return 0;
 
+#ifdef VM
+  /* A mapping may have scribbled past the end of file in the last
+     page, but growing the file must expose zeros there. */
+  if (offset + size > inode_length (inode))
+    pcache_clear_past (inode, inode_length (inode));
+#endif
+
   /* modified5 : file growth */
-  if(byte_to_sector(inode, offset + size - 1) == -1u ) {
-    bool success;
-    success = inode_allocate (& inode->data, offset + size);
-    if (!success) return 0; 
-    inode->data.length = offset + size;
-    bc_write (inode->sector, & inode->data);
-  }
+  if (!inode_extend (inode, offset + size))
+    return 0;
+
+  if (inode->data.is_inline)
+    {
+      uint8_t *cached = cached_byte (inode, offset, true);
+      if (cached != NULL)
+        memcpy (cached, buffer, size);
+      else
+        {
+          memcpy (inode->data.inline_data + offset, buffer, size);
+          inode_save (inode);
+        }
+      return size;
+    }
 
   while (size > 0)
     {
@@ -320,10 +679,35 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      uint8_t *cached = cached_byte (inode, offset, true);
+      if (cached == NULL && sector_idx != -1u
+          && (sector_idx & SECTOR_UNWRITTEN))
+        sector_idx = inode_mark_written (inode, offset / BLOCK_SECTOR_SIZE,
+                                         chunk_size < BLOCK_SECTOR_SIZE);
+
+      if (cached != NULL)
+        {
+          /* The page cache has the current copy. */
+          memcpy (cached, buffer + bytes_written, chunk_size);
+        }
+      else if (sector_idx == -1u)
+        {
+          /* Past the allocated blocks: keep the data in the cache
+             and choose a sector for it at writeback.  If the cache
+             has no room left, allocate our blocks now and retry. */
+          if (!bc_write_delayed (inode->sector, offset / BLOCK_SECTOR_SIZE,
+                                 sector_ofs, buffer + bytes_written,
+                                 chunk_size))
+            {
+              if (!inode_commit (inode))
+                break;
+              continue;
+            }
+        }
+      else if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
           /* modified5 : buffer cache */
-          bc_write (sector_idx, buffer + bytes_written);
+          data_write (inode, sector_idx, buffer + bytes_written);
         }
       else
         {
@@ -339,12 +723,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
              we're writing, then we need to read in the sector
              first.  Otherwise we start with a sector of all zeros. */
           if (sector_ofs > 0 || chunk_size < sector_left)
-            bc_read (sector_idx, bounce); //buffer cache
+            data_read (inode, sector_idx, bounce); //buffer cache
           else
             memset (bounce, 0, BLOCK_SECTOR_SIZE);
           memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
           /* modified5 : write to buffer cache */
-          bc_write (sector_idx, bounce);
+          data_write (inode, sector_idx, bounce);
         }
 
       /* Advance. */
@@ -357,6 +741,392 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   return bytes_written;
 }
 
+/* Copies SIZE bytes from SRC, starting at SRC_OFS, into DST,
+   starting at DST_OFS, moving the data slot-to-slot inside the
+   buffer cache.  DST grows as it would for inode_write_at().
+   Returns the number of bytes actually copied, which may be less
+   than SIZE if end of SRC is reached or DST cannot grow.
+   Overlapping ranges of one inode are only safe when DST_OFS is
+   below SRC_OFS. */
+off_t
+inode_copy_at (struct inode *dst, off_t dst_ofs,
+               struct inode *src, off_t src_ofs, off_t size)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  uint8_t chunk[BLOCK_SECTOR_SIZE];
+  off_t bytes_copied = 0;
+
+  if (dst->deny_write_cnt)
+    return 0;
+
+  /* Slot-to-slot copies need real sectors on both sides. */
+  if (!inode_commit (src))
+    return 0;
+
+  if (size > inode_length (src) - src_ofs)
+    size = inode_length (src) - src_ofs;
+  if (size <= 0)
+    return 0;
+
+  if (!inode_grow (dst, dst_ofs + size))
+    return 0;
+
+  /* Inline data has no sector to copy from or to, so bounce it.
+     Either way SIZE fits inside an inode. */
+  if (src->data.is_inline || dst->data.is_inline)
+    {
+      uint8_t *bounce = malloc (size);
+      if (bounce == NULL)
+        return 0;
+      size = inode_read_at (src, bounce, size, src_ofs);
+      size = inode_write_at (dst, bounce, size, dst_ofs);
+      free (bounce);
+      return size;
+    }
+
+  while (size > 0)
+    {
+      /* Sectors to copy between, starting byte offsets within them. */
+      block_sector_t src_idx = byte_to_sector (src, src_ofs);
+      block_sector_t dst_idx = byte_to_sector (dst, dst_ofs);
+      int src_sector_ofs = src_ofs % BLOCK_SECTOR_SIZE;
+      int dst_sector_ofs = dst_ofs % BLOCK_SECTOR_SIZE;
+
+      /* Bytes left in either sector, lesser of those and SIZE. */
+      int chunk_size = min (BLOCK_SECTOR_SIZE - src_sector_ofs,
+                            BLOCK_SECTOR_SIZE - dst_sector_ofs);
+      if (size < chunk_size)
+        chunk_size = size;
+
+      if (cached_byte (src, src_ofs, false) != NULL
+          || cached_byte (dst, dst_ofs, false) != NULL)
+        {
+          /* The page cache has the current copy of one side, so
+             go through it. */
+          inode_read_at (src, chunk, chunk_size, src_ofs);
+          inode_write_at (dst, chunk, chunk_size, dst_ofs);
+        }
+      else if (src_idx & SECTOR_UNWRITTEN)
+        {
+          /* Nothing to copy but zeros, which an unwritten
+             destination already holds. */
+          if (!(dst_idx & SECTOR_UNWRITTEN))
+            inode_write_at (dst, zeros, chunk_size, dst_ofs);
+        }
+      else
+        {
+          if (dst_idx & SECTOR_UNWRITTEN)
+            dst_idx = inode_mark_written (dst, dst_ofs / BLOCK_SECTOR_SIZE,
+                                          chunk_size < BLOCK_SECTOR_SIZE);
+          bc_copy (dst_idx, dst_sector_ofs, src_idx, src_sector_ofs,
+                   chunk_size, dst->sector);
+        }
+
+      /* Advance. */
+      size -= chunk_size;
+      src_ofs += chunk_size;
+      dst_ofs += chunk_size;
+      bytes_copied += chunk_size;
+    }
+
+  return bytes_copied;
+}
+
+/* Preallocates disk sectors for the LENGTH bytes of INODE that
+   start at OFFSET, extending INODE if they reach past its end.
+   The new sectors are laid out in one run where the free map
+   allows and read as zeros until they are first written.
+   Returns false if writes to INODE are denied or the disk is
+   full. */
+bool
+inode_fallocate (struct inode *inode, off_t offset, off_t length)
+{
+  off_t end = offset + length;
+
+  if (inode->deny_write_cnt || offset < 0 || length < 0 || end < offset)
+    return false;
+
+  /* Every block below the on-disk length already has a sector. */
+  if (!inode_commit (inode))
+    return false;
+  if (end <= inode->data.length)
+    return true;
+
+  if (inode->data.is_inline)
+    {
+      if ((size_t) end <= inline_max ())
+        return inode_grow (inode, end);
+      if (!inode_uninline (inode))
+        return false;
+    }
+
+  if (!inode_preallocate (&inode->data, end, inode->sector))
+    return false;
+  inode->length = inode->data.length;
+  inode_save (inode);
+  return true;
+}
+
+/* Sets the length of INODE to LENGTH bytes.  A file that grows
+   reads as zeros past its old end.  One that shrinks hands its
+   blocks past the new end to the reclaimer thread, so this returns
+   without waiting for them to be freed.  Returns false if writes
+   to INODE are denied, if the disk is full or if memory runs out. */
+bool
+inode_truncate (struct inode *inode, off_t length)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  struct reclaim_job *job;
+  off_t tail;
+
+  if (inode->deny_write_cnt || length < 0)
+    return false;
+  if (!inode_commit (inode))
+    return false;
+  if (length >= inode->data.length)
+    return inode_grow (inode, length);
+
+  job = malloc (sizeof *job);
+  if (job == NULL)
+    return false;
+  job->root_cnt = 0;
+
+  /* Bytes past end of file must read as zeros if it grows back. */
+  tail = min (ROUND_UP (length, BLOCK_SECTOR_SIZE), inode->data.length);
+  inode_write_at (inode, zeros, tail - length, length);
+#ifdef VM
+  pcache_truncate (inode, length);
+#endif
+
+  if (!inode->data.is_inline)
+    reclaim_cut (&inode->data, bytes_to_sectors (length), job,
+                 inode->sector);
+  inode->data.length = inode->length = length;
+  inode_save (inode);
+  reclaim_queue (job);
+  return true;
+}
+
+/* Writes every dirty buffer cache slot that belongs to INODE
+   (its data, its indirect blocks and the inode sector itself) back
+   to disk, along with the free map so that the blocks INODE uses
+   stay allocated. */
+void
+inode_sync (struct inode *inode)
+{
+#ifdef VM
+  pcache_flush (inode);
+#endif
+  inode_commit (inode);
+  bc_flush_inode (inode->sector);
+  if (compact)
+    bc_flush_sector (inode_table_sector (inode->sector));
+  bc_flush_inode (FREE_MAP_SECTOR);
+}
+
+/* Reads SIZE bytes of INODE starting at OFFSET into BUFFER for a
+   caller that caches them itself, bypassing the buffer cache.
+   Slots that already hold the data are handed over and freed, so
+   it is never cached twice.  Bytes past end of file read as
+   zeros.  OFFSET and SIZE must be multiples of BLOCK_SECTOR_SIZE.
+   Returns true if some of the data came from a dirty slot, that
+   is, if BUFFER is newer than the disk. */
+bool
+inode_read_uncached (struct inode *inode, void *buffer_, off_t size,
+                     off_t offset)
+{
+  uint8_t *buffer = buffer_;
+  off_t length = inode_length (inode);
+  bool dirty = false;
+  off_t ofs;
+
+  ASSERT (offset % BLOCK_SECTOR_SIZE == 0);
+  ASSERT (size % BLOCK_SECTOR_SIZE == 0);
+
+  memset (buffer, 0, size);
+  if (inode->data.is_inline)
+    {
+      if (offset < length)
+        memcpy (buffer, inode->data.inline_data + offset,
+                min (size, length - offset));
+      return false;
+    }
+
+  /* Delayed blocks must be on their sectors to be read. */
+  if (!inode_commit (inode))
+    return false;
+
+  for (ofs = 0; ofs < size && offset + ofs < length; ofs += BLOCK_SECTOR_SIZE)
+    {
+      block_sector_t sector_idx = byte_to_sector (inode, offset + ofs);
+      if (!(sector_idx & SECTOR_UNWRITTEN))
+        dirty |= bc_take (sector_idx, buffer + ofs);
+    }
+
+  /* The last sector may hold stale bytes past end of file. */
+  if (length - offset < size)
+    memset (buffer + (length - offset), 0, size - (length - offset));
+  return dirty;
+}
+
+/* Writes the SIZE bytes in BUFFER back to INODE starting at
+   OFFSET, straight to disk unless the buffer cache also holds
+   them.  Bytes past end of file are not written, and INODE does
+   not grow.  OFFSET and SIZE must be multiples of
+   BLOCK_SECTOR_SIZE. */
+void
+inode_write_uncached (struct inode *inode, const void *buffer_, off_t size,
+                      off_t offset)
+{
+  const uint8_t *buffer = buffer_;
+  off_t length = inode_length (inode);
+  off_t ofs;
+
+  ASSERT (offset % BLOCK_SECTOR_SIZE == 0);
+  ASSERT (size % BLOCK_SECTOR_SIZE == 0);
+
+  if (inode->data.is_inline)
+    {
+      if (offset < length)
+        {
+          memcpy (inode->data.inline_data + offset, buffer,
+                  min (size, length - offset));
+          inode_save (inode);
+        }
+      return;
+    }
+
+  if (!inode_commit (inode))
+    return;
+
+  for (ofs = 0; ofs < size && offset + ofs < length; ofs += BLOCK_SECTOR_SIZE)
+    {
+      block_sector_t sector_idx = byte_to_sector (inode, offset + ofs);
+      off_t inode_left = length - (offset + ofs);
+
+      if (sector_idx & SECTOR_UNWRITTEN)
+        sector_idx = inode_mark_written (inode,
+                                         (offset + ofs) / BLOCK_SECTOR_SIZE,
+                                         false);
+      if (inode_left < BLOCK_SECTOR_SIZE)
+        {
+          /* Keep the bytes past end of file zero on disk. */
+          uint8_t tail[BLOCK_SECTOR_SIZE];
+          memcpy (tail, buffer + ofs, inode_left);
+          memset (tail + inode_left, 0, BLOCK_SECTOR_SIZE - inode_left);
+          bc_write_around (sector_idx, tail, inode->sector);
+        }
+      else
+        bc_write_around (sector_idx, buffer + ofs, inode->sector);
+    }
+}
+
+/* Reads SIZE bytes from INODE into BUFFER, starting at OFFSET,
+   like inode_read_at() but straight from disk, one sector at a
+   time through a kernel bounce buffer, so that a large transfer
+   does not push everything else out of the buffer cache.  A
+   sector the buffer cache or page cache holds is copied from
+   there instead.  OFFSET must be a multiple of BLOCK_SECTOR_SIZE. */
+off_t
+inode_read_direct (struct inode *inode, void *buffer_, off_t size,
+                   off_t offset)
+{
+  uint8_t *buffer = buffer_;
+  off_t bytes_read = 0;
+  uint8_t *bounce;
+
+  ASSERT (offset % BLOCK_SECTOR_SIZE == 0);
+
+  /* Delayed blocks must be on their sectors to be read. */
+  if (inode->data.is_inline || !inode_commit (inode))
+    return inode_read_at (inode, buffer, size, offset);
+
+  if (size > inode_length (inode) - offset)
+    size = inode_length (inode) - offset;
+  if (size <= 0)
+    return 0;
+
+  bounce = malloc (BLOCK_SECTOR_SIZE);
+  if (bounce == NULL)
+    return inode_read_at (inode, buffer, size, offset);
+
+  while (bytes_read < size)
+    {
+      off_t pos = offset + bytes_read;
+      int chunk_size = min (size - bytes_read, BLOCK_SECTOR_SIZE);
+      block_sector_t sector_idx = byte_to_sector (inode, pos);
+      uint8_t *cached = cached_byte (inode, pos, false);
+
+      if (cached != NULL)
+        memcpy (bounce, cached, BLOCK_SECTOR_SIZE);
+      else if (sector_idx & SECTOR_UNWRITTEN)
+        memset (bounce, 0, BLOCK_SECTOR_SIZE);
+      else
+        bc_read_around (sector_idx, bounce);
+      memcpy (buffer + bytes_read, bounce, chunk_size);
+
+      bytes_read += chunk_size;
+    }
+  free (bounce);
+
+  return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+   like inode_write_at() but straight to disk, the counterpart of
+   inode_read_direct().  A sector the buffer cache or page cache
+   holds is updated there instead, so neither goes stale.  OFFSET
+   and SIZE must be multiples of BLOCK_SECTOR_SIZE. */
+off_t
+inode_write_direct (struct inode *inode, const void *buffer_, off_t size,
+                    off_t offset)
+{
+  const uint8_t *buffer = buffer_;
+  uint8_t *bounce;
+  off_t ofs;
+
+  ASSERT (offset % BLOCK_SECTOR_SIZE == 0);
+  ASSERT (size % BLOCK_SECTOR_SIZE == 0);
+
+  if (inode->deny_write_cnt || size <= 0)
+    return 0;
+
+#ifdef VM
+  if (offset + size > inode_length (inode))
+    pcache_clear_past (inode, inode_length (inode));
+#endif
+
+  /* Give every block its sector first.  New ones are unwritten, so
+     nothing is zeroed on disk only to be overwritten. */
+  if (!inode_fallocate (inode, offset, size) || inode->data.is_inline)
+    return inode_write_at (inode, buffer, size, offset);
+
+  bounce = malloc (BLOCK_SECTOR_SIZE);
+  if (bounce == NULL)
+    return inode_write_at (inode, buffer, size, offset);
+
+  for (ofs = 0; ofs < size; ofs += BLOCK_SECTOR_SIZE)
+    {
+      off_t pos = offset + ofs;
+      uint8_t *cached = cached_byte (inode, pos, true);
+
+      memcpy (bounce, buffer + ofs, BLOCK_SECTOR_SIZE);
+      if (cached != NULL)
+        memcpy (cached, bounce, BLOCK_SECTOR_SIZE);
+      else
+        {
+          block_sector_t sector_idx = byte_to_sector (inode, pos);
+          if (sector_idx & SECTOR_UNWRITTEN)
+            sector_idx = inode_mark_written (inode, pos / BLOCK_SECTOR_SIZE,
+                                             false);
+          bc_write_around (sector_idx, bounce, inode->sector);
+        }
+    }
+  free (bounce);
+
+  return size;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -381,7 +1151,264 @@ inode_allow_write (struct inode *inode)
 off_t
 inode_length (const struct inode *inode)
 {
-  return inode->data.length;
+  return inode->length;
+}
+
+/* Allocates the delayed blocks of every open inode, so that a
+   following bc_flush_all() writes out all file data. */
+void
+inode_commit_all (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e))
+    inode_commit (list_entry (e, struct inode, elem));
+}
+
+/* Returns true if delayed blocks should get their sectors now,
+   because the buffer cache has had to evict around them or the
+   oldest is DELAYED_EXPIRE ticks old, so that delayed data neither
+   crowds the cache nor stays off the disk until close.  The caller
+   then runs inode_commit_all() with file_lock held, from outside
+   the file system. */
+bool
+inode_writeback_due (void)
+{
+  return (bc_delayed_pressure ()
+          || (delayed_inode_cnt > 0
+              && timer_elapsed (delayed_since) >= DELAYED_EXPIRE));
+}
+
+/* Returns the longest file that can be stored inline. */
+static size_t
+inline_max (void)
+{
+  return compact ? COMPACT_INLINE_MAX : INLINE_DATA_MAX;
+}
+
+/* Allocates an unused inode number and stores it into *INUMBERP.
+   Outside a compact inode table that is a free sector.  Returns
+   false if there are none left. */
+bool
+inumber_allocate (block_sector_t *inumberp)
+{
+  if (!compact)
+    return free_map_allocate (1, inumberp);
+
+  size_t inumber = bitmap_scan_and_flip (inode_map, 0, 1, false);
+  if (inumber == BITMAP_ERROR)
+    return false;
+  *inumberp = inumber;
+  return true;
+}
+
+/* Makes inode number INUMBER available again. */
+void
+inumber_release (block_sector_t inumber)
+{
+  static const struct inode_compact unused;
+
+  if (!compact)
+    {
+      free_map_release (inumber, 1);
+      return;
+    }
+
+  bc_write_at (inode_table_sector (inumber), inode_table_offset (inumber),
+               &unused, sizeof unused, inumber);
+  bitmap_reset (inode_map, inumber);
+}
+
+/* Returns the number of sectors at the start of the device taken
+   by the inode table, which is 0 if there is none. */
+size_t
+inode_table_sectors (void)
+{
+  return compact ? table_cnt : 0;
+}
+
+/* Lays out an empty compact inode table at the start of the
+   device, sized for the device, and marks the free map's, the
+   root directory's and the table's own inode numbers used. */
+static void
+inode_table_format (void)
+{
+  static const uint8_t zeros[BLOCK_SECTOR_SIZE];
+  struct inode_compact table;
+  size_t inode_cnt;
+
+  ASSERT (sizeof table * INODES_PER_SECTOR == BLOCK_SECTOR_SIZE);
+
+  table_cnt = DIV_ROUND_UP (block_size (fs_device) / INODE_RATIO,
+                            INODES_PER_SECTOR);
+  inode_cnt = table_cnt * INODES_PER_SECTOR;
+  inode_map = bitmap_create (inode_cnt);
+  if (inode_map == NULL)
+    PANIC ("inode table bitmap creation failed");
+  bitmap_mark (inode_map, FREE_MAP_SECTOR);
+  bitmap_mark (inode_map, ROOT_DIR_SECTOR);
+  bitmap_mark (inode_map, INODE_TABLE_INUMBER);
+
+  /* Nothing is cached yet, so the zeros can go straight to disk. */
+  for (size_t i = 0; i < table_cnt; i++)
+    block_write (fs_device, i, zeros);
+
+  memset (&table, 0, sizeof table);
+  table.length = table_cnt * BLOCK_SECTOR_SIZE;
+  table.magic = INODE_TABLE_MAGIC;
+  bc_write_at (inode_table_sector (INODE_TABLE_INUMBER),
+               inode_table_offset (INODE_TABLE_INUMBER),
+               &table, sizeof table, INODE_TABLE_INUMBER);
+}
+
+/* Finds out whether the device has a compact inode table and, if
+   so, which of its inode numbers are in use. */
+static void
+inode_table_mount (void)
+{
+  struct inode_compact *table = malloc (BLOCK_SECTOR_SIZE);
+  if (table == NULL)
+    PANIC ("can't read inode table");
+
+  bc_read_meta (0, table);
+  compact = table[INODE_TABLE_INUMBER].magic == INODE_TABLE_MAGIC;
+  if (compact)
+    {
+      table_cnt = table[INODE_TABLE_INUMBER].length / BLOCK_SECTOR_SIZE;
+      inode_map = bitmap_create (table_cnt * INODES_PER_SECTOR);
+      if (inode_map == NULL)
+        PANIC ("inode table bitmap creation failed");
+      bitmap_mark (inode_map, FREE_MAP_SECTOR);
+      bitmap_mark (inode_map, ROOT_DIR_SECTOR);
+      bitmap_mark (inode_map, INODE_TABLE_INUMBER);
+
+      /* Read the table once, around the cache, which it would
+         only flood. */
+      for (size_t i = 0; i < table_cnt; i++)
+        {
+          block_read (fs_device, i, table);
+          for (size_t j = 0; j < INODES_PER_SECTOR; j++)
+            if (table[j].magic == INODE_COMPACT_MAGIC)
+              bitmap_mark (inode_map, i * INODES_PER_SECTOR + j);
+        }
+    }
+  free (table);
+}
+
+/* Returns the sector of the compact inode table holding inode
+   INUMBER. */
+static block_sector_t
+inode_table_sector (block_sector_t inumber)
+{
+  return inumber / INODES_PER_SECTOR;
+}
+
+/* Returns the byte offset of inode INUMBER within its sector of
+   the compact inode table. */
+static int
+inode_table_offset (block_sector_t inumber)
+{
+  return inumber % INODES_PER_SECTOR * sizeof (struct inode_compact);
+}
+
+/* Reads INODE's on-disk inode into its DATA, expanding a compact
+   one into the full inode_disk form the rest of this file uses. */
+static void
+inode_load (struct inode *inode)
+{
+  struct inode_compact slot;
+
+  inode->index_sector = 0;
+  if (!compact)
+    {
+      bc_read_meta (inode->sector, &inode->data);
+      return;
+    }
+
+  /* DATA is one sector long, so it can take the table sector. */
+  bc_read_meta (inode_table_sector (inode->sector), &inode->data);
+  memcpy (&slot, (uint8_t *) &inode->data + inode_table_offset (inode->sector),
+          sizeof slot);
+
+  if (!slot.is_inline)
+    {
+      inode->index_sector = slot.index_sector;
+      bc_read_meta (inode->index_sector, &inode->data);
+      return;
+    }
+
+  memset (&inode->data, 0, sizeof inode->data);
+  memcpy (inode->data.inline_data, slot.inline_data, COMPACT_INLINE_MAX);
+  inode->data.is_dir = slot.is_dir;
+  inode->data.is_inline = true;
+  inode->data.length = slot.length;
+  inode->data.magic = INODE_MAGIC;
+}
+
+/* Writes IDISK out as the on-disk inode INUMBER.  In a compact
+   table an inode that is not inline also needs INDEX_SECTOR, the
+   sector its block pointers go to. */
+static void
+inode_store (block_sector_t inumber, const struct inode_disk *idisk,
+             block_sector_t index_sector)
+{
+  struct inode_compact slot;
+
+  if (!compact)
+    {
+      bc_write_meta (inumber, idisk, inumber);
+      return;
+    }
+
+  memset (&slot, 0, sizeof slot);
+  if (idisk->is_inline)
+    {
+      ASSERT ((size_t) idisk->length <= COMPACT_INLINE_MAX);
+      memcpy (slot.inline_data, idisk->inline_data, COMPACT_INLINE_MAX);
+    }
+  else
+    {
+      ASSERT (index_sector != 0);
+      slot.index_sector = index_sector;
+      bc_write_meta (index_sector, idisk, inumber);
+    }
+  slot.is_dir = idisk->is_dir;
+  slot.is_inline = idisk->is_inline;
+  slot.length = idisk->length;
+  slot.magic = INODE_COMPACT_MAGIC;
+  bc_write_at (inode_table_sector (inumber), inode_table_offset (inumber),
+               &slot, sizeof slot, inumber);
+}
+
+/* Writes INODE's DATA back to disk. */
+static void
+inode_save (struct inode *inode)
+{
+  inode_store (inode->sector, &inode->data, inode->index_sector);
+}
+
+/* Reads data SECTOR of INODE through the buffer cache, as
+   metadata if INODE is a directory. */
+static void
+data_read (const struct inode *inode, block_sector_t sector, void *buffer)
+{
+  if (inode->data.is_dir)
+    bc_read_meta (sector, buffer);
+  else
+    bc_read (sector, buffer);
+}
+
+/* Writes data SECTOR of INODE through the buffer cache, as
+   metadata if INODE is a directory. */
+static void
+data_write (const struct inode *inode, block_sector_t sector,
+            const void *buffer)
+{
+  if (inode->data.is_dir)
+    bc_write_meta (sector, buffer, inode->sector);
+  else
+    bc_write (sector, buffer, inode->sector);
 }
 
 /* ================== modified5 : directory ============================ */
@@ -417,7 +1444,7 @@ index_to_sector (const struct inode_disk *idisk, off_t block_index)
     struct inode_indirect_block 
     *indirect_block = calloc(1, sizeof(struct inode_indirect_block));
 
-    bc_read (idisk->indirect_block, indirect_block);
+    bc_read_meta (idisk->indirect_block, indirect_block);
     result = indirect_block->blocks[block_index - base];
    
     free(indirect_block);
@@ -434,8 +1461,8 @@ index_to_sector (const struct inode_disk *idisk, off_t block_index)
     struct inode_indirect_block 
     *indirect_block = calloc(1, sizeof(struct inode_indirect_block));
 
-    bc_read (idisk->doubly_indirect_block, indirect_block);
-    bc_read (indirect_block->blocks[single_index], indirect_block);
+    bc_read_meta (idisk->doubly_indirect_block, indirect_block);
+    bc_read_meta (indirect_block->blocks[single_index], indirect_block);
     result = indirect_block->blocks[doubly_index];
 
     free(indirect_block);
@@ -445,8 +1472,68 @@ index_to_sector (const struct inode_disk *idisk, off_t block_index)
   return -1;
 }
 
+/* Makes sure index block *SECTOR exists, allocating and zeroing
+   it on behalf of the inode at sector OWNER if it is still 0. */
+static bool
+index_block_get (block_sector_t *sector, block_sector_t owner)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+
+  if (*sector != 0)
+    return true;
+  if (!free_map_allocate (1, sector))
+    return false;
+  bc_write_meta (*sector, zeros, owner);
+  return true;
+}
+
+/* Points block BLOCK_INDEX of IDISK at SECTOR, creating indirect
+   blocks on the way as needed.  The reverse of index_to_sector(). */
+static bool
+index_set_sector (struct inode_disk *idisk, off_t block_index,
+                  block_sector_t sector, block_sector_t owner)
+{
+  struct inode_indirect_block indirect_block;
+  block_sector_t *single;
+
+  // direct
+  if (block_index < DIRECT_BLOCKS) {
+    idisk->direct_blocks[block_index] = sector;
+    return true;
+  }
+  block_index -= DIRECT_BLOCKS;
+
+  // single indirect
+  if (block_index < INDIRECT_BLOCKS_PER_SECTOR)
+    single = &idisk->indirect_block;
+
+  // doubly indirect
+  else {
+    block_index -= INDIRECT_BLOCKS_PER_SECTOR;
+    if (!index_block_get (&idisk->doubly_indirect_block, owner))
+      return false;
+
+    bc_read_meta (idisk->doubly_indirect_block, &indirect_block);
+    single = &indirect_block.blocks[block_index / INDIRECT_BLOCKS_PER_SECTOR];
+    if (*single == 0) {
+      if (!index_block_get (single, owner))
+        return false;
+      bc_write_meta (idisk->doubly_indirect_block, &indirect_block, owner);
+    }
+    block_index %= INDIRECT_BLOCKS_PER_SECTOR;
+  }
+
+  if (!index_block_get (single, owner))
+    return false;
+  block_sector_t single_sector = *single;
+  bc_read_meta (single_sector, &indirect_block);
+  indirect_block.blocks[block_index] = sector;
+  bc_write_meta (single_sector, &indirect_block, owner);
+  return true;
+}
+
 bool
-inode_allocate (struct inode_disk *idisk, off_t length)
+inode_allocate (struct inode_disk *idisk, off_t length, block_sector_t owner)
 {
   static char zeros[BLOCK_SECTOR_SIZE];
   size_t bound;
@@ -465,7 +1552,7 @@ inode_allocate (struct inode_disk *idisk, off_t length)
   for (size_t i = 0; i < bound; i++) {
     if (idisk->direct_blocks[i] == 0) {
       if(!free_map_allocate(1, &idisk->direct_blocks[i])) return false;
-      bc_write (idisk->direct_blocks[i], zeros);
+      bc_write (idisk->direct_blocks[i], zeros, owner);
     }
   }
 
@@ -476,7 +1563,7 @@ inode_allocate (struct inode_disk *idisk, off_t length)
   // indirect
   if(remain_index < INDIRECT_BLOCKS_PER_SECTOR) bound = remain_index;
   else bound = INDIRECT_BLOCKS_PER_SECTOR;
-  if(!inode_allocate_indirect(&idisk->indirect_block, bound, 1)) return false;
+  if(!inode_allocate_indirect(&idisk->indirect_block, bound, 1, owner)) return false;
   
   remain_index -= bound;
   if(remain_index == 0) goto done; 
@@ -484,7 +1571,7 @@ inode_allocate (struct inode_disk *idisk, off_t length)
 
   // doubly indirect 
   bound = remain_index;
-  if(!inode_allocate_indirect(&idisk->doubly_indirect_block, bound, 2)) return false;
+  if(!inode_allocate_indirect(&idisk->doubly_indirect_block, bound, 2, owner)) return false;
   remain_index -= bound;
  
 done:
@@ -492,7 +1579,8 @@ done:
 }
 
 static bool
-inode_allocate_indirect (block_sector_t* sector, size_t remain_index, int level)
+inode_allocate_indirect (block_sector_t* sector, size_t remain_index, int level,
+                         block_sector_t owner)
 {
   static char zeros[BLOCK_SECTOR_SIZE];
   size_t bound, subsize, unit = 1;
@@ -502,7 +1590,7 @@ inode_allocate_indirect (block_sector_t* sector, size_t remain_index, int level)
   if (level == 0) {
     if (*sector == 0) {
       if(!free_map_allocate(1, sector)) return false;
-      bc_write (*sector, zeros);
+      bc_write (*sector, zeros, owner);
     }
     return true;
   }
@@ -511,26 +1599,355 @@ inode_allocate_indirect (block_sector_t* sector, size_t remain_index, int level)
   struct inode_indirect_block indirect_block;
   if(*sector == 0) {
      if(!free_map_allocate(1, sector)) return false;
-    bc_write (*sector, zeros);
+    bc_write_meta (*sector, zeros, owner);
   }
-  bc_read(*sector, &indirect_block);
+  bc_read_meta (*sector, &indirect_block);
 
   bound = remain_index / unit + 1;
   for (size_t i = 0; i < bound; i++) {
     if(remain_index > unit) subsize = unit;
     else subsize = remain_index;
 
-    if(!inode_allocate_indirect(&indirect_block.blocks[i], subsize, level - 1)) return false;
+    if(!inode_allocate_indirect(&indirect_block.blocks[i], subsize, level - 1, owner)) return false;
     remain_index -= subsize;
   }
-  bc_write (*sector, &indirect_block);
+  bc_write_meta (*sector, &indirect_block, owner);
+  return true;
+}
+
+/* Returns the number of sectors, data and index blocks both,
+   that a file with DATA_SECTORS data sectors occupies. */
+static size_t
+index_sectors (size_t data_sectors)
+{
+  size_t total = data_sectors;
+
+  if (data_sectors > DIRECT_BLOCKS)
+    total++;
+  if (data_sectors > DIRECT_BLOCKS + INDIRECT_BLOCKS_PER_SECTOR)
+    total += 1 + DIV_ROUND_UP (data_sectors - DIRECT_BLOCKS
+                               - INDIRECT_BLOCKS_PER_SECTOR,
+                               INDIRECT_BLOCKS_PER_SECTOR);
+  return total;
+}
+
+/* Returns the number of free sectors reserved for INODE's delayed
+   blocks. */
+static size_t
+inode_reserved (const struct inode *inode)
+{
+  return (index_sectors (bytes_to_sectors (inode->length))
+          - index_sectors (bytes_to_sectors (inode->data.length)));
+}
+
+/* Extends INODE so that it holds LENGTH bytes for a write.  New
+   blocks of a block-mapped inode are only reserved in the free
+   map; their data stays in the buffer cache until inode_commit()
+   lays them all out at once.  Falls back to inode_grow() when
+   the cache has no room for that many delayed blocks.
+   Returns false if the disk is full. */
+static bool
+inode_extend (struct inode *inode, off_t length)
+{
+  size_t new_blocks, reserve;
+
+  if (length <= inode->length)
+    return true;
+  if (inode->data.is_inline
+      || bytes_to_sectors (length) > MAX_DATA_SECTORS)
+    return inode_grow (inode, length);
+
+  /* Make room by allocating this inode's own delayed blocks. */
+  new_blocks = bytes_to_sectors (length) - bytes_to_sectors (inode->length);
+  if (new_blocks > bc_delayed_room () && inode->length > inode->data.length)
+    {
+      inode_commit (inode);
+      new_blocks = bytes_to_sectors (length) - bytes_to_sectors (inode->length);
+    }
+  if (new_blocks > bc_delayed_room ())
+    return inode_grow (inode, length);
+
+  reserve = (index_sectors (bytes_to_sectors (length))
+             - index_sectors (bytes_to_sectors (inode->length)));
+  if (!free_map_reserve (reserve))
+    return false;
+
+  if (inode->length == inode->data.length && delayed_inode_cnt++ == 0)
+    delayed_since = timer_ticks ();
+  inode->length = length;
+  return true;
+}
+
+/* Discards INODE's delayed blocks and the sectors reserved for
+   them, shrinking it back to its committed length. */
+static void
+inode_drop_delayed (struct inode *inode)
+{
+  if (inode->length <= inode->data.length)
+    return;
+  bc_drop_delayed (inode->sector);
+  free_map_unreserve (inode_reserved (inode));
+  inode->length = inode->data.length;
+  delayed_inode_cnt--;
+}
+
+/* Gives INODE's delayed blocks their disk sectors, one contiguous
+   run if the free map has one, and records the new length in the
+   on-disk inode.  The sectors were reserved by inode_extend(), so
+   this fails only if the free map cannot be written.  Then the
+   sectors taken so far are given back and the data stays delayed,
+   unless its reservation cannot be restored either, and false is
+   returned. */
+static bool
+inode_commit (struct inode *inode)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  size_t first, cnt, reserved, done;
+  block_sector_t start = 0;
+  bool contiguous;
+
+  if (inode->length <= inode->data.length)
+    return true;
+
+  first = bytes_to_sectors (inode->data.length);
+  cnt = bytes_to_sectors (inode->length) - first;
+  reserved = inode_reserved (inode);
+  free_map_unreserve (reserved);
+
+  /* Lay out every sector before handing any delayed block over,
+     so that a failure leaves the delayed data as it was. */
+  contiguous = cnt > 0 && free_map_allocate (cnt, &start);
+  for (done = 0; done < cnt; done++)
+    {
+      block_sector_t sector = start + done;
+
+      if (!contiguous && !free_map_allocate (1, &sector))
+        goto fail;
+      if (!index_set_sector (&inode->data, first + done, sector,
+                             inode->sector))
+        {
+          if (!contiguous)
+            free_map_release (sector, 1);
+          goto fail;
+        }
+    }
+
+  for (size_t i = 0; i < cnt; i++)
+    {
+      block_sector_t sector = index_to_sector (&inode->data, first + i);
+
+      if (!bc_assign_delayed (inode->sector, first + i, sector))
+        bc_write (sector, zeros, inode->sector);
+    }
+
+  inode->data.length = inode->length;
+  inode_save (inode);
+  delayed_inode_cnt--;
+  return true;
+
+ fail:
+  for (size_t i = 0; i < done; i++)
+    {
+      if (!contiguous)
+        free_map_release (index_to_sector (&inode->data, first + i), 1);
+      index_set_sector (&inode->data, first + i, 0, inode->sector);
+    }
+  if (contiguous)
+    free_map_release (start, cnt);
+  if (!free_map_reserve (reserved))
+    {
+      /* Index blocks made on the way keep some of the space. */
+      bc_drop_delayed (inode->sector);
+      inode->length = inode->data.length;
+      delayed_inode_cnt--;
+    }
+  return false;
+}
+
+/* Extends INODE so that it holds LENGTH bytes, allocating and
+   zeroing any missing sectors.  Does nothing if INODE is already
+   long enough.  Returns false if the disk is full. */
+static bool
+inode_grow (struct inode *inode, off_t length)
+{
+  if (!inode_commit (inode))
+    return false;
+  if (length <= inode->data.length)
+    return true;
+
+  if (inode->data.is_inline)
+    {
+      if ((size_t) length <= inline_max ())
+        {
+          /* Bytes past the old end are already zero. */
+          inode->data.length = inode->length = length;
+          inode_save (inode);
+          return true;
+        }
+      if (!inode_uninline (inode))
+        return false;
+    }
+
+  if (!inode_allocate (&inode->data, length, inode->sector))
+    return false;
+  inode->data.length = inode->length = length;
+  inode_save (inode);
+  return true;
+}
+
+/* Moves INODE's inline data out to a freshly allocated data
+   sector, turning it into an ordinary block-mapped inode of the
+   same length.  Returns false, leaving INODE inline and with no
+   more sectors than before, if memory or the disk is short. */
+static bool
+inode_uninline (struct inode *inode)
+{
+  struct inode_disk *saved = malloc (sizeof *saved);
+  uint8_t *block = calloc (1, BLOCK_SECTOR_SIZE);
+  bool new_index = false;
+
+  if (saved == NULL || block == NULL)
+    goto fail;
+
+  /* The block pointers need a sector of their own in a compact
+     table, and keep it until the inode is deleted. */
+  if (compact && inode->index_sector == 0)
+    {
+      if (!free_map_allocate (1, &inode->index_sector))
+        goto fail;
+      new_index = true;
+    }
+
+  memcpy (saved, &inode->data, sizeof *saved);
+  memset (inode->data.inline_data, 0, INLINE_DATA_MAX);
+  inode->data.is_inline = false;
+  if (!inode_allocate (&inode->data, inode->data.length, inode->sector))
+    {
+      /* Inline data is shorter than a sector, so the first block
+         is the only one that may have been allocated. */
+      if (inode->data.direct_blocks[0] != 0)
+        free_map_release (inode->data.direct_blocks[0], 1);
+      memcpy (&inode->data, saved, sizeof *saved);
+      if (new_index)
+        {
+          free_map_release (inode->index_sector, 1);
+          inode->index_sector = 0;
+        }
+      goto fail;
+    }
+
+  /* The first data sector gets the old inline bytes, zero padded. */
+  if (inode->data.length > 0)
+    {
+      memcpy (block, saved->inline_data, inode->data.length);
+      data_write (inode, inode->data.direct_blocks[0], block);
+    }
+  free (block);
+  free (saved);
+
+  inode_save (inode);
+  return true;
+
+ fail:
+  free (block);
+  free (saved);
+  return false;
+}
+
+/* Gives IDISK a sector for every block up to LENGTH bytes, one
+   contiguous run if the free map has one, marked unwritten so
+   that they need not be zeroed on disk.  Blocks IDISK already has
+   are kept.  Returns false if the disk is full. */
+static bool
+inode_preallocate (struct inode_disk *idisk, off_t length,
+                   block_sector_t owner)
+{
+  size_t first, cnt;
+  block_sector_t start = 0;
+  bool contiguous;
+
+  if (length <= idisk->length)
+    return true;
+  if (bytes_to_sectors (length) > MAX_DATA_SECTORS)
+    return false;
+
+  first = bytes_to_sectors (idisk->length);
+  cnt = bytes_to_sectors (length) - first;
+  contiguous = cnt > 0 && free_map_allocate (cnt, &start);
+  for (size_t i = 0; i < cnt; i++)
+    {
+      block_sector_t sector = start + i;
+
+      if (!contiguous && !free_map_allocate (1, &sector))
+        return false;
+      if (!index_set_sector (idisk, first + i, sector | SECTOR_UNWRITTEN,
+                             owner))
+        return false;
+    }
+
+  idisk->length = length;
   return true;
 }
 
+/* Clears the unwritten mark of block BLOCK_INDEX of INODE and
+   returns its sector.  If ZERO, the block's cached copy starts
+   out as zeros, so that a partial write never reads the stale
+   disk contents. */
+static block_sector_t
+inode_mark_written (struct inode *inode, off_t block_index, bool zero)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  block_sector_t sector = (index_to_sector (&inode->data, block_index)
+                           & ~SECTOR_UNWRITTEN);
+
+  index_set_sector (&inode->data, block_index, sector, inode->sector);
+  inode_save (inode);
+  if (zero)
+    bc_write (sector, zeros, inode->sector);
+  return sector;
+}
+
+/* Returns where the page cache holds byte OFFSET of INODE, or a
+   null pointer if that page is not cached.  If WRITE, the page is
+   marked dirty for the caller to modify.  The free map cannot be
+   mapped, so it is never cached; it is written while the page cache
+   commits delayed blocks under its lock, so it must not look. */
+static uint8_t *
+cached_byte (struct inode *inode UNUSED, off_t offset UNUSED,
+             bool write UNUSED)
+{
+#ifdef VM
+  struct pcache_page *page;
+
+  if (inode->sector == FREE_MAP_SECTOR)
+    return NULL;
+  page = pcache_lookup (inode, offset / PGSIZE);
+  if (page != NULL)
+    {
+      if (write)
+        page->dirty = true;
+      return (uint8_t *) page->kaddr + offset % PGSIZE;
+    }
+#endif
+  return NULL;
+}
+
+/* Frees the blocks of removed INODE.  The reclaimer thread does
+   the work unless there is no memory to queue it. */
 static void 
 inode_free (struct inode *inode)
 {
   if(inode->data.length < 0) return;
+  if(inode->data.is_inline) return;
+
+  struct reclaim_job *job = malloc (sizeof *job);
+  if (job != NULL)
+    {
+      job->root_cnt = 0;
+      reclaim_cut (&inode->data, 0, job, inode->sector);
+      reclaim_queue (job);
+      return;
+    }
 
   size_t remain_index = bytes_to_sectors(inode->data.length);
   size_t bound;
@@ -539,7 +1956,7 @@ inode_free (struct inode *inode)
   if(remain_index < DIRECT_BLOCKS) bound = remain_index;
   else bound = DIRECT_BLOCKS;
   for (size_t i = 0; i < bound; i++) 
-    free_map_release (inode->data.direct_blocks[i], 1);
+    free_map_release (inode->data.direct_blocks[i] & ~SECTOR_UNWRITTEN, 1);
   remain_index -= bound;
 
   // indirect 
@@ -566,7 +1983,7 @@ inode_free_indirect (block_sector_t sector, size_t remain_index, int level)
    size_t bound, subsize, unit = 1;
 
   if (level == 0) {
-    free_map_release (sector, 1);
+    free_map_release (sector & ~SECTOR_UNWRITTEN, 1);
     return;
   }
 
@@ -584,4 +2001,190 @@ inode_free_indirect (block_sector_t sector, size_t remain_index, int level)
   }
 
   free_map_release (sector, 1);
-}
\ No newline at end of file
+}
+/* ================== background block reclamation ===================== */
+
+/* Moves data blocks FIRST and up of IDISK into JOB, along with the
+   index blocks that only they use.  The pointers to them are
+   cleared, in IDISK and in the index blocks that still map blocks
+   below FIRST on behalf of the inode at sector OWNER, so that the
+   file can grow back without reusing them. */
+static void
+reclaim_cut (struct inode_disk *idisk, size_t first,
+             struct reclaim_job *job, block_sector_t owner)
+{
+  struct inode_indirect_block doubly;
+  size_t total = bytes_to_sectors (idisk->length);
+  size_t base, cnt, start, i;
+
+  // direct
+  for (i = first; i < min (total, DIRECT_BLOCKS); i++)
+    {
+      reclaim_add (job, idisk->direct_blocks[i], 0);
+      idisk->direct_blocks[i] = 0;
+    }
+
+  // single indirect
+  base = DIRECT_BLOCKS;
+  if (total <= base)
+    return;
+  cnt = min (total - base, INDIRECT_BLOCKS_PER_SECTOR);
+  if (first <= base)
+    {
+      reclaim_add (job, idisk->indirect_block, cnt);
+      idisk->indirect_block = 0;
+    }
+  else if (first < base + cnt)
+    reclaim_cut_block (idisk->indirect_block, first - base, cnt, job, owner);
+
+  // doubly indirect
+  base += INDIRECT_BLOCKS_PER_SECTOR;
+  if (total <= base)
+    return;
+  start = first > base ? first - base : 0;
+  bc_read_meta (idisk->doubly_indirect_block, &doubly);
+  for (i = start / INDIRECT_BLOCKS_PER_SECTOR;
+       i * INDIRECT_BLOCKS_PER_SECTOR < total - base; i++)
+    {
+      size_t ofs = i * INDIRECT_BLOCKS_PER_SECTOR;
+
+      cnt = min (total - base - ofs, INDIRECT_BLOCKS_PER_SECTOR);
+      if (start <= ofs)
+        {
+          reclaim_add (job, doubly.blocks[i], cnt);
+          doubly.blocks[i] = 0;
+        }
+      else
+        reclaim_cut_block (doubly.blocks[i], start - ofs, cnt, job, owner);
+    }
+  if (start == 0)
+    {
+      reclaim_add (job, idisk->doubly_indirect_block, 0);
+      idisk->doubly_indirect_block = 0;
+    }
+  else
+    bc_write_meta (idisk->doubly_indirect_block, &doubly, owner);
+}
+
+/* Moves data blocks FIRST through CNT - 1 of index block SECTOR
+   into JOB and clears their pointers. */
+static void
+reclaim_cut_block (block_sector_t sector, size_t first, size_t cnt,
+                   struct reclaim_job *job, block_sector_t owner)
+{
+  struct inode_indirect_block block;
+  size_t i;
+
+  bc_read_meta (sector, &block);
+  for (i = first; i < cnt; i++)
+    {
+      reclaim_add (job, block.blocks[i], 0);
+      block.blocks[i] = 0;
+    }
+  bc_write_meta (sector, &block, owner);
+}
+
+/* Adds SECTOR to JOB: a data block if CNT is 0, otherwise an index
+   block and the first CNT data blocks it points to. */
+static void
+reclaim_add (struct reclaim_job *job, block_sector_t sector, size_t cnt)
+{
+  ASSERT (job->root_cnt < RECLAIM_ROOTS);
+  job->roots[job->root_cnt].sector = sector;
+  job->roots[job->root_cnt].cnt = cnt;
+  job->root_cnt++;
+}
+
+/* Hands JOB to the reclaimer thread, which frees it when done. */
+static void
+reclaim_queue (struct reclaim_job *job)
+{
+  if (job->root_cnt == 0)
+    {
+      free (job);
+      return;
+    }
+  lock_acquire (&reclaim_lock);
+  list_push_back (&reclaim_jobs, &job->elem);
+  cond_signal (&reclaim_ready, &reclaim_lock);
+  lock_release (&reclaim_lock);
+}
+
+/* Frees roots off the end of JOB, at most RECLAIM_BATCH sectors
+   in all, with a single write of the free map.  Dead index blocks
+   are read around the buffer cache, since they will never be
+   needed again. */
+static void
+reclaim_step (struct reclaim_job *job)
+{
+  block_sector_t sectors[RECLAIM_BATCH];
+  struct inode_indirect_block block;
+  size_t cnt = 0;
+
+  while (job->root_cnt > 0
+         && cnt + job->roots[job->root_cnt - 1].cnt + 1 <= RECLAIM_BATCH)
+    {
+      job->root_cnt--;
+      block_sector_t sector = job->roots[job->root_cnt].sector;
+      size_t children = job->roots[job->root_cnt].cnt;
+
+      if (children > 0)
+        {
+          bc_read_around (sector, &block);
+          for (size_t i = 0; i < children; i++)
+            sectors[cnt++] = block.blocks[i] & ~SECTOR_UNWRITTEN;
+        }
+      sectors[cnt++] = sector & ~SECTOR_UNWRITTEN;
+    }
+  free_map_release_list (sectors, cnt);
+}
+
+/* Reclaimer thread.  Works through reclaim_jobs a batch at a time,
+   yielding in between so that a large file does not hold up other
+   threads. */
+static void
+reclaim_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      struct reclaim_job *job;
+
+      lock_acquire (&reclaim_lock);
+      while (list_empty (&reclaim_jobs))
+        cond_wait (&reclaim_ready, &reclaim_lock);
+      job = list_entry (list_front (&reclaim_jobs), struct reclaim_job, elem);
+      lock_release (&reclaim_lock);
+
+      reclaim_step (job);
+
+      lock_acquire (&reclaim_lock);
+      if (job->root_cnt == 0)
+        {
+          list_remove (&job->elem);
+          free (job);
+          if (list_empty (&reclaim_jobs))
+            cond_broadcast (&reclaim_idle, &reclaim_lock);
+        }
+      lock_release (&reclaim_lock);
+      thread_yield ();
+    }
+}
+
+/* Waits until the reclaimer thread has freed every block queued
+   for it.  Returns true if there was anything to wait for, false
+   if not or if the caller cannot sleep. */
+bool
+inode_reclaim_wait (void)
+{
+  bool waited;
+
+  if (intr_context () || intr_get_level () == INTR_OFF)
+    return false;
+
+  lock_acquire (&reclaim_lock);
+  waited = !list_empty (&reclaim_jobs);
+  while (!list_empty (&reclaim_jobs))
+    cond_wait (&reclaim_idle, &reclaim_lock);
+  lock_release (&reclaim_lock);
+  return waited;
+}
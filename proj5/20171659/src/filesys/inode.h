@@ -7,7 +7,10 @@
 
 struct bitmap;
 
-void inode_init (void);
+void inode_init (bool format, bool compact_table);
+bool inumber_allocate (block_sector_t *);
+void inumber_release (block_sector_t);
+size_t inode_table_sectors (void);
 bool inode_create (block_sector_t, off_t, bool);
 struct inode *inode_open (block_sector_t);
 struct inode *inode_reopen (struct inode *);
@@ -16,6 +19,21 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_read_direct (struct inode *, void *, off_t size, off_t offset);
+off_t inode_write_direct (struct inode *, const void *, off_t size,
+                          off_t offset);
+off_t inode_copy_at (struct inode *dst, off_t dst_ofs,
+                     struct inode *src, off_t src_ofs, off_t size);
+bool inode_fallocate (struct inode *, off_t offset, off_t length);
+bool inode_truncate (struct inode *, off_t length);
+bool inode_read_uncached (struct inode *, void *, off_t size, off_t offset);
+void inode_write_uncached (struct inode *, const void *, off_t size,
+                           off_t offset);
+void inode_sync (struct inode *);
+void inode_commit_all (void);
+bool inode_writeback_due (void);
+size_t inode_cache_reclaim (size_t cnt);
+bool inode_reclaim_wait (void);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
@@ -30,7 +30,27 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Positional and vectored I/O. */
+    SYS_PREAD,                  /* Read from a file at an offset. */
+    SYS_PWRITE,                 /* Write to a file at an offset. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write several buffers to a file. */
+    SYS_COPY_FILE_RANGE,        /* Copy between files inside the kernel. */
+    SYS_FALLOCATE,              /* Preallocate space for a file. */
+    SYS_FTRUNCATE,              /* Change the length of a file. */
+    SYS_DIRECTIO,               /* Bypass the buffer cache for a file. */
+
+    /* Durability. */
+    SYS_FSYNC,                  /* Write a file's cached data to disk. */
+    SYS_SYNC,                   /* Write all cached data to disk. */
+
+    /* Benchmarking. */
+    SYS_FSSTAT,                 /* Get timer ticks and disk counters. */
+
+    /* Process cloning. */
+    SYS_FORK                    /* Copy this process. */
   };
 
 #endif /* lib/syscall-nr.h */
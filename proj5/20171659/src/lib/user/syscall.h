@@ -12,9 +12,30 @@ typedef int pid_t;
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
 
+/* Counters reported by fsstat(), for timing file system work. */
+struct fsstat
+  {
+    long long ticks;                    /* Timer ticks since boot. */
+    unsigned long long read_cnt;        /* Sectors read from disk. */
+    unsigned long long write_cnt;       /* Sectors written to disk. */
+    unsigned used_cnt;                  /* Sectors in use by files. */
+    unsigned reserved_cnt;              /* Free sectors held for data
+                                           not yet given a sector. */
+  };
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* One buffer of a readv() or writev() request. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    unsigned iov_len;           /* Length of buffer in bytes. */
+  };
+
+/* Maximum number of buffers in a single readv() or writev(). */
+#define IOV_MAX 64
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
@@ -49,4 +70,24 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Positional and vectored I/O. */
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+bool fallocate (int fd, unsigned offset, unsigned length);
+bool ftruncate (int fd, unsigned length);
+bool directio (int fd, bool on);
+
+/* Durability. */
+int fsync (int fd);
+void sync (void);
+
+/* Benchmarking. */
+void fsstat (struct fsstat *);
+
+/* Process cloning. */
+pid_t fork (void);
+
 #endif /* lib/user/syscall.h */
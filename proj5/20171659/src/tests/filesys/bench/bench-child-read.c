@@ -0,0 +1,30 @@
+/* Child process for bench-readers.
+   Reads the shared file from start to end in 512-byte blocks. */
+
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/bench/bench-readers.h"
+
+int
+main (int argc, const char *argv[]) 
+{
+  char block[512];
+  int child_idx;
+  int fd;
+  size_t ofs;
+
+  test_name = "bench-child-read";
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (ofs = 0; ofs < BUF_SIZE; ofs += sizeof block)
+    CHECK (read (fd, block, sizeof block) == sizeof block,
+           "read \"%s\"", file_name);
+  close (fd);
+
+  return child_idx;
+}
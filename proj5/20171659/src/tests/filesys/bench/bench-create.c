@@ -0,0 +1,39 @@
+/* Creates and then removes many small files in one directory. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define FILE_CNT 100
+
+void
+test_main (void) 
+{
+  char file_name[16];
+  struct bench b;
+  int i;
+
+  CHECK (mkdir ("many"), "mkdir \"many\"");
+
+  bench_start (&b, "create");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (file_name, sizeof file_name, "many/f%d", i);
+      if (!create (file_name, 0))
+        fail ("create \"%s\" failed", file_name);
+    }
+  sync ();
+  bench_stop (&b, FILE_CNT, 0);
+
+  bench_start (&b, "remove");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (file_name, sizeof file_name, "many/f%d", i);
+      if (!remove (file_name))
+        fail ("remove \"%s\" failed", file_name);
+    }
+  sync ();
+  bench_stop (&b, FILE_CNT, 0);
+}
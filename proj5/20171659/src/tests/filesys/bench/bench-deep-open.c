@@ -0,0 +1,38 @@
+/* Opens a file at the bottom of a deep directory tree over and
+   over, through its absolute path. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define DEPTH 16
+#define OP_CNT 200
+
+void
+test_main (void) 
+{
+  char path[DEPTH * 3 + 16] = "";
+  struct bench b;
+  int i;
+
+  for (i = 0; i < DEPTH; i++) 
+    {
+      strlcat (path, "/d", sizeof path);
+      if (!mkdir (path))
+        fail ("mkdir \"%s\" failed", path);
+    }
+  strlcat (path, "/leaf", sizeof path);
+  CHECK (create (path, 0), "create leaf at depth %d", DEPTH);
+
+  bench_start (&b, "deep open");
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      int fd = open (path);
+      if (fd < 2)
+        fail ("open \"%s\" failed", path);
+      close (fd);
+    }
+  bench_stop (&b, OP_CNT, 0);
+}
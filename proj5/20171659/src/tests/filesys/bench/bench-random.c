@@ -0,0 +1,52 @@
+/* Reads and writes single blocks at random offsets in a file
+   larger than the buffer cache. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define BLOCK_SIZE 512
+#define BLOCK_CNT 512
+#define OP_CNT 1000
+
+static char buf[BLOCK_SIZE * BLOCK_CNT];
+
+void
+test_main (void) 
+{
+  const char *file_name = "random";
+  char block[BLOCK_SIZE];
+  struct bench b;
+  int fd;
+  int i;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"%s\"", file_name);
+  fsync (fd);
+
+  bench_start (&b, "random read");
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      size_t ofs = random_ulong () % BLOCK_CNT * BLOCK_SIZE;
+      if (pread (fd, block, BLOCK_SIZE, ofs) != BLOCK_SIZE)
+        fail ("read block at offset %zu failed", ofs);
+    }
+  bench_stop (&b, OP_CNT, OP_CNT * BLOCK_SIZE);
+
+  bench_start (&b, "random write");
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      size_t ofs = random_ulong () % BLOCK_CNT * BLOCK_SIZE;
+      if (pwrite (fd, buf + ofs, BLOCK_SIZE, ofs) != BLOCK_SIZE)
+        fail ("write block at offset %zu failed", ofs);
+    }
+  fsync (fd);
+  bench_stop (&b, OP_CNT, OP_CNT * BLOCK_SIZE);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
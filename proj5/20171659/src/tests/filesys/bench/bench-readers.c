@@ -0,0 +1,40 @@
+/* Times 1, 2, 4 and 8 child processes all reading the same file
+   at once, to see how reads scale with concurrency. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+#include "tests/filesys/bench/bench-readers.h"
+
+#define MAX_READERS 8
+
+static char buf[BUF_SIZE];
+
+void
+test_main (void) 
+{
+  pid_t children[MAX_READERS];
+  char name[32];
+  struct bench b;
+  size_t cnt;
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  for (cnt = 1; cnt <= MAX_READERS; cnt *= 2) 
+    {
+      snprintf (name, sizeof name, "%zu readers", cnt);
+      bench_start (&b, name);
+      exec_children ("bench-child-read", children, cnt);
+      wait_children (children, cnt);
+      bench_stop (&b, cnt, cnt * sizeof buf);
+    }
+}
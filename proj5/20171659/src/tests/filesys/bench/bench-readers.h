@@ -0,0 +1,7 @@
+#ifndef TESTS_FILESYS_BENCH_BENCH_READERS_H
+#define TESTS_FILESYS_BENCH_BENCH_READERS_H
+
+#define BUF_SIZE (32 * 1024)
+static const char file_name[] = "shared";
+
+#endif /* tests/filesys/bench/bench-readers.h */
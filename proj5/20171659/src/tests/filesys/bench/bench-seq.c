@@ -0,0 +1,57 @@
+/* Writes a large file sequentially, then reads it back
+   sequentially, in small and in large blocks. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define FILE_SIZE (256 * 1024)
+
+static char buf[FILE_SIZE];
+
+static void
+seq_write (const char *name, const char *file_name, size_t block_size) 
+{
+  struct bench b;
+  size_t ofs;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  bench_start (&b, name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += block_size)
+    if (write (fd, buf + ofs, block_size) != (int) block_size)
+      fail ("write %zu bytes at offset %zu failed", block_size, ofs);
+  fsync (fd);
+  bench_stop (&b, FILE_SIZE / block_size, FILE_SIZE);
+  close (fd);
+}
+
+static void
+seq_read (const char *name, const char *file_name, size_t block_size) 
+{
+  static char block[4096];
+  struct bench b;
+  size_t ofs;
+  int fd;
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  bench_start (&b, name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += block_size)
+    if (read (fd, block, block_size) != (int) block_size)
+      fail ("read %zu bytes at offset %zu failed", block_size, ofs);
+  bench_stop (&b, FILE_SIZE / block_size, FILE_SIZE);
+  close (fd);
+}
+
+void
+test_main (void) 
+{
+  random_bytes (buf, sizeof buf);
+  seq_write ("seq write 512", "small", 512);
+  seq_read ("seq read 512", "small", 512);
+  seq_write ("seq write 4096", "large", 4096);
+  seq_read ("seq read 4096", "large", 4096);
+}
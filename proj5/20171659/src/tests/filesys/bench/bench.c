@@ -0,0 +1,47 @@
+#include "tests/filesys/bench/bench.h"
+#include <stdio.h>
+#include "tests/lib.h"
+
+/* Starts timing B, which bench_stop() reports as NAME. */
+void
+bench_start (struct bench *b, const char *name) 
+{
+  b->name = name;
+  fsstat (&b->start);
+}
+
+/* Prints 100 * NUM / DEN as a fixed point number with two
+   decimals into BUF. */
+static const char *
+ratio (char buf[32], long long num, long long den) 
+{
+  long long hundredths = den > 0 ? num * 100 / den : 0;
+  snprintf (buf, 32, "%lld.%02lld", hundredths / 100, hundredths % 100);
+  return buf;
+}
+
+/* Stops timing B, which did OP_CNT operations moving BYTE_CNT
+   bytes in all, and prints the elapsed timer ticks and the disk
+   sectors read and written, in total and per operation. */
+void
+bench_stop (struct bench *b, int op_cnt, size_t byte_cnt) 
+{
+  struct fsstat end;
+  long long ticks;
+  long long reads, writes;
+  char t[32], r[32], w[32];
+
+  fsstat (&end);
+  ticks = end.ticks - b->start.ticks;
+  reads = end.read_cnt - b->start.read_cnt;
+  writes = end.write_cnt - b->start.write_cnt;
+
+  msg ("%s: %d ops, %lld ticks, %lld reads, %lld writes", b->name, op_cnt,
+       ticks, reads, writes);
+  msg ("%s: per op %s ticks, %s reads, %s writes", b->name,
+       ratio (t, ticks, op_cnt), ratio (r, reads, op_cnt),
+       ratio (w, writes, op_cnt));
+  if (byte_cnt > 0)
+    msg ("%s: %lld bytes/tick", b->name,
+         ticks > 0 ? (long long) byte_cnt / ticks : (long long) byte_cnt);
+}
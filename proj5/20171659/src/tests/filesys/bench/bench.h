@@ -0,0 +1,17 @@
+#ifndef TESTS_FILESYS_BENCH_BENCH_H
+#define TESTS_FILESYS_BENCH_BENCH_H
+
+#include <stddef.h>
+#include <syscall.h>
+
+/* One timed stretch of a benchmark. */
+struct bench
+  {
+    const char *name;           /* Printed with the results. */
+    struct fsstat start;        /* Counters when it started. */
+  };
+
+void bench_start (struct bench *, const char *name);
+void bench_stop (struct bench *, int op_cnt, size_t byte_cnt);
+
+#endif /* tests/filesys/bench/bench.h */
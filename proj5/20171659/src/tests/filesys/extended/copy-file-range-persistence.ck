@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($data) = random_bytes (5000);
+check_archive ({"src" => [$data], "dst" => [$data]});
+pass;
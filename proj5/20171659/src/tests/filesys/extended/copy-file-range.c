@@ -0,0 +1,39 @@
+/* Copies a file inside the kernel with copy_file_range(), in two
+   pieces so that the second one starts in the middle of a
+   sector, and checks that both file positions advance. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[5000];
+
+void
+test_main (void) 
+{
+  int src_fd, dst_fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("src", 0), "create \"src\"");
+  CHECK (create ("dst", 0), "create \"dst\"");
+  CHECK ((src_fd = open ("src")) > 1, "open \"src\"");
+  CHECK ((dst_fd = open ("dst")) > 1, "open \"dst\"");
+  CHECK (write (src_fd, buf, sizeof buf) == sizeof buf, "write \"src\"");
+
+  msg ("seek \"src\"");
+  seek (src_fd, 0);
+  CHECK (copy_file_range (src_fd, dst_fd, 1234) == 1234,
+         "copy first 1234 bytes");
+  CHECK (copy_file_range (src_fd, dst_fd, 10000) == sizeof buf - 1234,
+         "copy rest of \"src\"");
+  CHECK (tell (src_fd) == sizeof buf && tell (dst_fd) == sizeof buf,
+         "tell after copy");
+  CHECK (copy_file_range (src_fd, dst_fd, 1) == 0, "copy at end of file");
+
+  msg ("close \"src\"");
+  close (src_fd);
+  msg ("close \"dst\"");
+  close (dst_fd);
+  check_file ("dst", buf, sizeof buf);
+}
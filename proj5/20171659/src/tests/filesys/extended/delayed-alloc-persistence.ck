@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+check_archive ({"delayed" => [("\0" x 1024) . random_bytes (4096)]});
+pass;
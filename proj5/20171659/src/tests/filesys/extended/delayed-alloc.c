@@ -0,0 +1,70 @@
+/* Extends a file with delayed allocation, checking that the new
+   blocks are only reserved in the free map until fsync(), that
+   they read back before then, and that fsync() turns exactly
+   that reservation into allocated sectors. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Starts out block-mapped, past the longest inline file. */
+#define INITIAL_SIZE 1024
+
+/* Eight data blocks, all of them direct. */
+#define DATA_SIZE 4096
+
+static char buf[DATA_SIZE];
+static char readback[DATA_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "delayed";
+  struct fsstat before, written, synced, closed;
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, INITIAL_SIZE), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  fsstat (&before);
+
+  seek (fd, INITIAL_SIZE);
+  CHECK (write (fd, buf, DATA_SIZE) == DATA_SIZE, "write \"%s\"", file_name);
+  fsstat (&written);
+  CHECK (written.used_cnt == before.used_cnt,
+         "no sectors allocated before fsync");
+  CHECK (written.reserved_cnt == before.reserved_cnt + DATA_SIZE / 512,
+         "%d sectors reserved before fsync", DATA_SIZE / 512);
+
+  seek (fd, INITIAL_SIZE);
+  CHECK (read (fd, readback, DATA_SIZE) == DATA_SIZE,
+         "read \"%s\" before fsync", file_name);
+  if (memcmp (buf, readback, DATA_SIZE))
+    fail ("data read back before fsync differs from data written");
+  msg ("verified data before fsync");
+
+  CHECK (fsync (fd) == 0, "fsync \"%s\"", file_name);
+  fsstat (&synced);
+  CHECK (synced.reserved_cnt == before.reserved_cnt,
+         "no sectors reserved after fsync");
+  CHECK (synced.used_cnt == before.used_cnt + DATA_SIZE / 512,
+         "%d sectors allocated after fsync", DATA_SIZE / 512);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  fsstat (&closed);
+  CHECK (closed.used_cnt == synced.used_cnt
+         && closed.reserved_cnt == synced.reserved_cnt,
+         "close leaves the free map alone");
+
+  CHECK ((fd = open (file_name)) > 1, "reopen \"%s\"", file_name);
+  seek (fd, INITIAL_SIZE);
+  CHECK (read (fd, readback, DATA_SIZE) == DATA_SIZE,
+         "read \"%s\" after close", file_name);
+  if (memcmp (buf, readback, DATA_SIZE))
+    fail ("data read back after close differs from data written");
+  msg ("verified data after close");
+  close (fd);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(delayed-alloc) begin
+(delayed-alloc) create "delayed"
+(delayed-alloc) open "delayed"
+(delayed-alloc) write "delayed"
+(delayed-alloc) no sectors allocated before fsync
+(delayed-alloc) 8 sectors reserved before fsync
+(delayed-alloc) read "delayed" before fsync
+(delayed-alloc) verified data before fsync
+(delayed-alloc) fsync "delayed"
+(delayed-alloc) no sectors reserved after fsync
+(delayed-alloc) 8 sectors allocated after fsync
+(delayed-alloc) close "delayed"
+(delayed-alloc) close leaves the free map alone
+(delayed-alloc) reopen "delayed"
+(delayed-alloc) read "delayed" after close
+(delayed-alloc) verified data after close
+(delayed-alloc) end
+EOF
+pass;
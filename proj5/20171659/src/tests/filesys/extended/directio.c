@@ -0,0 +1,57 @@
+/* Writes and reads a file with direct I/O turned on, checking
+   that direct transfers stay coherent with ordinary ones through
+   the buffer cache on a second descriptor, and that transfers
+   that are not whole sectors still work. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 6144
+
+static char buf[FILE_SIZE];
+static char tmp[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "direct";
+  int fd, fd2;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK ((fd2 = open (file_name)) > 1, "open \"%s\" again", file_name);
+  CHECK (directio (fd, true), "directio \"%s\"", file_name);
+
+  /* Direct reads see data still dirty in the cache. */
+  CHECK (pwrite (fd2, buf, 1024, 0) == 1024, "cached pwrite \"%s\"", file_name);
+  CHECK (pread (fd, tmp, 1024, 0) == 1024, "direct pread \"%s\"", file_name);
+  if (memcmp (tmp, buf, 1024))
+    fail ("direct read missed cached data");
+
+  /* Direct writes update sectors that are cached. */
+  CHECK (pwrite (fd, buf + 3072, 1024, 1024) == 1024,
+         "direct pwrite \"%s\"", file_name);
+  CHECK (pread (fd2, tmp, 1024, 1024) == 1024, "cached pread \"%s\"", file_name);
+  if (memcmp (tmp, buf + 3072, 1024))
+    fail ("cached read missed direct data");
+  CHECK (pwrite (fd, buf + 1024, FILE_SIZE - 1024, 1024) == FILE_SIZE - 1024,
+         "direct pwrite \"%s\" again", file_name);
+  CHECK (pread (fd2, tmp, FILE_SIZE, 0) == FILE_SIZE,
+         "cached pread \"%s\" again", file_name);
+  if (memcmp (tmp, buf, FILE_SIZE))
+    fail ("cached read missed direct data");
+
+  /* Partial sectors fall back to the cache. */
+  CHECK (pwrite (fd, buf + 100, 50, 100) == 50,
+         "unaligned pwrite \"%s\"", file_name);
+  CHECK (filesize (fd) == FILE_SIZE, "filesize \"%s\"", file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  close (fd2);
+  check_file (file_name, buf, sizeof buf);
+}
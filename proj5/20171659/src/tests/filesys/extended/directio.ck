@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(directio) begin
+(directio) create "direct"
+(directio) open "direct"
+(directio) open "direct" again
+(directio) directio "direct"
+(directio) cached pwrite "direct"
+(directio) direct pread "direct"
+(directio) direct pwrite "direct"
+(directio) cached pread "direct"
+(directio) direct pwrite "direct" again
+(directio) cached pread "direct" again
+(directio) unaligned pwrite "direct"
+(directio) filesize "direct"
+(directio) close "direct"
+(directio) open "direct" for verification
+(directio) verified contents of "direct"
+(directio) close "direct"
+(directio) end
+EOF
+pass;
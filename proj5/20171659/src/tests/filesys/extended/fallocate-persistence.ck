@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($data) = ("\0" x 4900) . random_bytes (1500) . ("\0" x 13600);
+check_archive ({"prealloc" => [$data]});
+pass;
@@ -0,0 +1,48 @@
+/* Preallocates space for a file with fallocate(), checking that
+   the file grows, reads back as zeros, and takes writes both into
+   whole preallocated sectors and into parts of them. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 20000
+
+static char buf[FILE_SIZE];
+static char data[1500];
+
+void
+test_main (void) 
+{
+  const char *file_name = "prealloc";
+  char block[512];
+  int fd;
+  size_t i;
+
+  random_bytes (data, sizeof data);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (fallocate (fd, 0, FILE_SIZE), "fallocate \"%s\"", file_name);
+  CHECK (filesize (fd) == FILE_SIZE, "filesize \"%s\"", file_name);
+  CHECK (tell (fd) == 0, "tell \"%s\"", file_name);
+
+  CHECK (pread (fd, block, sizeof block, 7000) == sizeof block,
+         "pread \"%s\"", file_name);
+  for (i = 0; i < sizeof block; i++)
+    if (block[i] != 0)
+      fail ("byte %zu of preallocated block is %02hhx", i, block[i]);
+
+  /* One partial sector, one whole sector, one partial sector. */
+  CHECK (pwrite (fd, data, sizeof data, 4900) == sizeof data,
+         "pwrite \"%s\"", file_name);
+  CHECK (fallocate (fd, 100, 1000), "fallocate inside \"%s\"", file_name);
+  CHECK (filesize (fd) == FILE_SIZE, "filesize \"%s\" unchanged", file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  memcpy (buf + 4900, data, sizeof data);
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fallocate) begin
+(fallocate) create "prealloc"
+(fallocate) open "prealloc"
+(fallocate) fallocate "prealloc"
+(fallocate) filesize "prealloc"
+(fallocate) tell "prealloc"
+(fallocate) pread "prealloc"
+(fallocate) pwrite "prealloc"
+(fallocate) fallocate inside "prealloc"
+(fallocate) filesize "prealloc" unchanged
+(fallocate) close "prealloc"
+(fallocate) open "prealloc" for verification
+(fallocate) verified contents of "prealloc"
+(fallocate) close "prealloc"
+(fallocate) end
+EOF
+pass;
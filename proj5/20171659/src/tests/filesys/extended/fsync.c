@@ -0,0 +1,31 @@
+/* Writes a file and flushes it with fsync() and sync(), checking
+   that flushing leaves the data and file position intact. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[1500];
+
+void
+test_main (void) 
+{
+  const char *file_name = "durable";
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, 1000) == 1000, "write \"%s\"", file_name);
+  CHECK (fsync (fd) == 0, "fsync \"%s\"", file_name);
+  CHECK (tell (fd) == 1000, "tell \"%s\" after fsync", file_name);
+  CHECK (write (fd, buf + 1000, 500) == 500, "write \"%s\" again", file_name);
+  msg ("sync");
+  sync ();
+  CHECK (fsync (fd + 100) == -1, "fsync bad fd");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
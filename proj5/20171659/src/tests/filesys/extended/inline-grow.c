@@ -0,0 +1,58 @@
+/* Grows a file that starts out inside its inode past the 500
+   bytes the inode can hold, checking that it only takes sectors
+   once it outgrows the inode and that the bytes written while it
+   was inline read back intact from block storage. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Bytes written while the file is still inline. */
+#define INLINE_SIZE 100
+
+/* Final size, past the longest inline file. */
+#define FILE_SIZE 1000
+
+static char buf[FILE_SIZE];
+static char readback[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "mover";
+  struct fsstat before, inline_st, moved;
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  fsstat (&before);
+
+  CHECK (write (fd, buf, INLINE_SIZE) == INLINE_SIZE,
+         "write %d bytes to \"%s\"", INLINE_SIZE, file_name);
+  fsstat (&inline_st);
+  CHECK (inline_st.used_cnt == before.used_cnt
+         && inline_st.reserved_cnt == before.reserved_cnt,
+         "\"%s\" is still inline", file_name);
+
+  CHECK (write (fd, buf + INLINE_SIZE, FILE_SIZE - INLINE_SIZE)
+         == FILE_SIZE - INLINE_SIZE,
+         "write \"%s\" up to %d bytes", file_name, FILE_SIZE);
+  CHECK (filesize (fd) == FILE_SIZE, "filesize \"%s\"", file_name);
+  fsstat (&moved);
+  CHECK (moved.used_cnt > before.used_cnt,
+         "\"%s\" moved to block storage", file_name);
+
+  seek (fd, 0);
+  CHECK (read (fd, readback, FILE_SIZE) == FILE_SIZE,
+         "read \"%s\" after the move", file_name);
+  if (memcmp (buf, readback, FILE_SIZE))
+    fail ("data read back after the move differs from data written");
+  msg ("verified data of \"%s\" after the move", file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
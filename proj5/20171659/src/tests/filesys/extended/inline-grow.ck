@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(inline-grow) begin
+(inline-grow) create "mover"
+(inline-grow) open "mover"
+(inline-grow) write 100 bytes to "mover"
+(inline-grow) "mover" is still inline
+(inline-grow) write "mover" up to 1000 bytes
+(inline-grow) filesize "mover"
+(inline-grow) "mover" moved to block storage
+(inline-grow) read "mover" after the move
+(inline-grow) verified data of "mover" after the move
+(inline-grow) close "mover"
+(inline-grow) open "mover" for verification
+(inline-grow) verified contents of "mover"
+(inline-grow) close "mover"
+(inline-grow) end
+EOF
+pass;
@@ -0,0 +1,46 @@
+/* Writes a file small enough to live inside its inode, checking
+   that it takes no sectors of its own and reads back intact, both
+   while it is open and after it is closed. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Fits inline in both the regular and the compact inode layout. */
+#define FILE_SIZE 100
+
+static char buf[FILE_SIZE];
+static char readback[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "small";
+  struct fsstat before, after;
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  fsstat (&before);
+
+  CHECK (write (fd, buf, FILE_SIZE) == FILE_SIZE, "write \"%s\"", file_name);
+  CHECK (fsync (fd) == 0, "fsync \"%s\"", file_name);
+  fsstat (&after);
+  CHECK (after.used_cnt == before.used_cnt
+         && after.reserved_cnt == before.reserved_cnt,
+         "\"%s\" takes no sectors", file_name);
+
+  seek (fd, 0);
+  CHECK (read (fd, readback, FILE_SIZE) == FILE_SIZE,
+         "read \"%s\"", file_name);
+  if (memcmp (buf, readback, FILE_SIZE))
+    fail ("data read back differs from data written");
+  msg ("verified data of \"%s\"", file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(inline-small) begin
+(inline-small) create "small"
+(inline-small) open "small"
+(inline-small) write "small"
+(inline-small) fsync "small"
+(inline-small) "small" takes no sectors
+(inline-small) read "small"
+(inline-small) verified data of "small"
+(inline-small) close "small"
+(inline-small) open "small" for verification
+(inline-small) verified contents of "small"
+(inline-small) close "small"
+(inline-small) end
+EOF
+pass;
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+random_bytes (1000);
+check_archive ({"new" => [random_bytes (500)]});
+pass;
@@ -0,0 +1,37 @@
+/* Closes a file and opens it again, which the inode cache serves
+   without reading the inode from disk, then removes the file and
+   creates another in its place, which may get the same inode
+   sector.  Checks that the new file does not inherit anything
+   cached for the old one. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[2000];
+
+void
+test_main (void) 
+{
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("old", 0), "create \"old\"");
+  CHECK ((fd = open ("old")) > 1, "open \"old\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"old\"");
+  msg ("close \"old\"");
+  close (fd);
+  check_file ("old", buf, sizeof buf);
+
+  CHECK (remove ("old"), "remove \"old\"");
+  CHECK (open ("old") == -1, "open \"old\" after removing it");
+
+  CHECK (create ("new", 0), "create \"new\"");
+  CHECK ((fd = open ("new")) > 1, "open \"new\"");
+  CHECK (filesize (fd) == 0, "filesize \"new\"");
+  CHECK (write (fd, buf + 1000, 500) == 500, "write \"new\"");
+  msg ("close \"new\"");
+  close (fd);
+  check_file ("new", buf + 1000, 500);
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(inode-reuse) begin
+(inode-reuse) create "old"
+(inode-reuse) open "old"
+(inode-reuse) write "old"
+(inode-reuse) close "old"
+(inode-reuse) open "old" for verification
+(inode-reuse) verified contents of "old"
+(inode-reuse) close "old"
+(inode-reuse) remove "old"
+(inode-reuse) open "old" after removing it
+(inode-reuse) create "new"
+(inode-reuse) open "new"
+(inode-reuse) filesize "new"
+(inode-reuse) write "new"
+(inode-reuse) close "new"
+(inode-reuse) open "new" for verification
+(inode-reuse) verified contents of "new"
+(inode-reuse) close "new"
+(inode-reuse) end
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Writes a file out of order with pwrite() and reads it back
+   with pread(), checking that neither call moves the file
+   position. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[2000];
+static char back[2000];
+
+void
+test_main (void) 
+{
+  const char *file_name = "pfile";
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  CHECK (pwrite (fd, buf + 1000, 1000, 1000) == 1000,
+         "pwrite second half of \"%s\"", file_name);
+  CHECK (pwrite (fd, buf, 1000, 0) == 1000,
+         "pwrite first half of \"%s\"", file_name);
+  CHECK (tell (fd) == 0, "tell \"%s\" after pwrite", file_name);
+
+  CHECK (pread (fd, back + 1500, 500, 1500) == 500,
+         "pread tail of \"%s\"", file_name);
+  CHECK (pread (fd, back, 1500, 0) == 1500,
+         "pread head of \"%s\"", file_name);
+  CHECK (pread (fd, back, 100, sizeof buf) == 0,
+         "pread past end of \"%s\"", file_name);
+  CHECK (tell (fd) == 0, "tell \"%s\" after pread", file_name);
+  compare_bytes (back, buf, sizeof buf, 0, file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
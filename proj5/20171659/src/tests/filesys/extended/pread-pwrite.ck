@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "pfile"
+(pread-pwrite) open "pfile"
+(pread-pwrite) pwrite second half of "pfile"
+(pread-pwrite) pwrite first half of "pfile"
+(pread-pwrite) tell "pfile" after pwrite
+(pread-pwrite) pread tail of "pfile"
+(pread-pwrite) pread head of "pfile"
+(pread-pwrite) pread past end of "pfile"
+(pread-pwrite) tell "pfile" after pread
+(pread-pwrite) close "pfile"
+(pread-pwrite) open "pfile" for verification
+(pread-pwrite) verified contents of "pfile"
+(pread-pwrite) close "pfile"
+(pread-pwrite) end
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Gathers a file from several buffers with writev() and
+   scatters it back into differently sized buffers with
+   readv(). */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[3000];
+static char back[3000];
+
+void
+test_main (void) 
+{
+  const char *file_name = "vfile";
+  struct iovec out[3] = {
+    { buf, 700 }, { buf + 700, 1 }, { buf + 701, 2299 },
+  };
+  struct iovec in[2] = {
+    { back, 1024 }, { back + 1024, 1976 },
+  };
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (writev (fd, out, 3) == sizeof buf, "writev \"%s\"", file_name);
+  CHECK (tell (fd) == sizeof buf, "tell \"%s\" after writev", file_name);
+
+  msg ("seek \"%s\"", file_name);
+  seek (fd, 0);
+  CHECK (readv (fd, in, 2) == sizeof buf, "readv \"%s\"", file_name);
+  CHECK (readv (fd, in, 2) == 0, "readv \"%s\" at end of file", file_name);
+  compare_bytes (back, buf, sizeof buf, 0, file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
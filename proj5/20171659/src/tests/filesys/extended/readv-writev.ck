@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "vfile"
+(readv-writev) open "vfile"
+(readv-writev) writev "vfile"
+(readv-writev) tell "vfile" after writev
+(readv-writev) seek "vfile"
+(readv-writev) readv "vfile"
+(readv-writev) readv "vfile" at end of file
+(readv-writev) close "vfile"
+(readv-writev) open "vfile" for verification
+(readv-writev) verified contents of "vfile"
+(readv-writev) close "vfile"
+(readv-writev) end
+EOF
+pass;
@@ -0,0 +1,63 @@
+/* Cuts a file down with ftruncate() partway into its indirect
+   block, checking that the data before the cut survives and that
+   the file reads back as zeros when it grows again.  Then writes
+   and removes a file half the size of the disk several times,
+   which only fits if the blocks of each removed copy come back. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 102400
+#define CUT_SIZE 70000
+#define GROW_SIZE 80000
+#define FINAL_SIZE 1000
+#define BIG_SIZE (1024 * 1024)
+
+static char buf[FILE_SIZE];
+static char tmp[FILE_SIZE];
+static char chunk[4096];
+
+void
+test_main (void) 
+{
+  const char *file_name = "trunc";
+  int fd, round;
+  size_t ofs;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, FILE_SIZE) == FILE_SIZE, "write \"%s\"", file_name);
+  CHECK (ftruncate (fd, CUT_SIZE), "truncate \"%s\"", file_name);
+  CHECK (filesize (fd) == CUT_SIZE, "filesize \"%s\"", file_name);
+
+  /* Growing back must not expose the old data. */
+  CHECK (ftruncate (fd, GROW_SIZE), "extend \"%s\"", file_name);
+  CHECK (pread (fd, tmp, GROW_SIZE, 0) == GROW_SIZE, "pread \"%s\"", file_name);
+  if (memcmp (tmp, buf, CUT_SIZE))
+    fail ("data before the cut changed");
+  for (ofs = CUT_SIZE; ofs < GROW_SIZE; ofs++)
+    if (tmp[ofs] != 0)
+      fail ("byte %zu past the cut is %02hhx", ofs, tmp[ofs]);
+
+  CHECK (ftruncate (fd, FINAL_SIZE), "truncate \"%s\" again", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  for (round = 0; round < 3; round++)
+    {
+      CHECK (create ("big", 0), "create \"big\", round %d", round);
+      CHECK ((fd = open ("big")) > 1, "open \"big\", round %d", round);
+      for (ofs = 0; ofs < BIG_SIZE; ofs += sizeof chunk)
+        if (write (fd, chunk, sizeof chunk) != sizeof chunk)
+          fail ("write \"big\" failed at offset %zu, round %d", ofs, round);
+      msg ("close \"big\", round %d", round);
+      close (fd);
+      CHECK (remove ("big"), "remove \"big\", round %d", round);
+    }
+
+  check_file (file_name, buf, FINAL_SIZE);
+}
@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(truncate) begin
+(truncate) create "trunc"
+(truncate) open "trunc"
+(truncate) write "trunc"
+(truncate) truncate "trunc"
+(truncate) filesize "trunc"
+(truncate) extend "trunc"
+(truncate) pread "trunc"
+(truncate) truncate "trunc" again
+(truncate) close "trunc"
+(truncate) create "big", round 0
+(truncate) open "big", round 0
+(truncate) close "big", round 0
+(truncate) remove "big", round 0
+(truncate) create "big", round 1
+(truncate) open "big", round 1
+(truncate) close "big", round 1
+(truncate) remove "big", round 1
+(truncate) create "big", round 2
+(truncate) open "big", round 2
+(truncate) close "big", round 2
+(truncate) remove "big", round 2
+(truncate) open "trunc" for verification
+(truncate) verified contents of "trunc"
+(truncate) close "trunc"
+(truncate) end
+EOF
+pass;
@@ -0,0 +1,68 @@
+/* Child process of page-text-share.
+   Checks a table that spans several read-only pages while it
+   pushes 512 kB of its own data out to swap, so that the text
+   pages it shares with the other children get evicted and come
+   back.  Also checks that its data pages are its own. */
+
+#include <string.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+
+#define SIZE (512 * 1024)
+
+#define DIGITS "0123456789abcdef"
+#define TEXT_256 DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS \
+                 DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS
+#define TEXT_4K TEXT_256 TEXT_256 TEXT_256 TEXT_256 TEXT_256 TEXT_256   \
+                TEXT_256 TEXT_256 TEXT_256 TEXT_256 TEXT_256 TEXT_256   \
+                TEXT_256 TEXT_256 TEXT_256 TEXT_256
+
+/* Read-only data, so it lives in the text segment. */
+static const char table[] = TEXT_4K TEXT_4K TEXT_4K;
+
+/* Written by each child, so each needs a copy of its own. */
+static char key[16] = "unset";
+
+static char buf[SIZE];
+
+/* Checks that every byte of the table is what was compiled in. */
+static void
+check_table (void)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof table - 1; i++)
+    if (table[i] != DIGITS[i % 16])
+      fail ("byte %zu of the shared table is wrong", i);
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct arc4 arc4;
+  int pass;
+  size_t i;
+
+  test_name = "child-text";
+  quiet = true;
+
+  strlcpy (key, argv[argc - 1], sizeof key);
+  for (pass = 0; pass < 2; pass++)
+    {
+      /* Encrypt zeros, then decrypt them again. */
+      check_table ();
+      arc4_init (&arc4, key, strlen (key));
+      arc4_crypt (&arc4, buf, SIZE);
+      check_table ();
+      arc4_init (&arc4, key, strlen (key));
+      arc4_crypt (&arc4, buf, SIZE);
+    }
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != '\0')
+      fail ("byte %zu != 0", i);
+  if (strcmp (key, argv[argc - 1]))
+    fail ("data segment holds \"%s\", not \"%s\"", key, argv[argc - 1]);
+
+  return 0x51;
+}
@@ -0,0 +1,61 @@
+/* Forks after writing to a buffer.  Parent and child then each
+   write their own byte over the shared pages and check that they
+   see only their own writes: the child must still see the parent's
+   data from before the fork, however the two are scheduled.  The
+   child also writes to pages the parent only reads, which must keep
+   the parent's bytes after the child has exited. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[2 * 4096 + 100];
+static char keep[2 * 4096 + 100];
+
+/* Checks that every byte of B, SIZE bytes long, is C. */
+static void
+check_bytes (const char *b, size_t size, char c, const char *who)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (b[i] != c)
+      fail ("%s sees byte %zu as '%c' instead of '%c'", who, i, b[i], c);
+}
+
+/* Checks that every byte of buf is C. */
+static void
+check_buf (char c, const char *who)
+{
+  check_bytes (buf, sizeof buf, c, who);
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  memset (buf, 'p', sizeof buf);
+  memset (keep, 'k', sizeof keep);
+
+  child = fork ();
+  if (child == 0)
+    {
+      check_buf ('p', "child");
+      memset (buf, 'c', sizeof buf);
+      check_buf ('c', "child");
+      check_bytes (keep, sizeof keep, 'k', "child");
+      memset (keep, 'c', sizeof keep);
+      check_bytes (keep, sizeof keep, 'c', "child");
+      exit (81);
+    }
+  CHECK (child > 0, "fork");
+
+  /* Written before the child may have run. */
+  memset (buf, 'P', sizeof buf);
+  check_buf ('P', "parent");
+  CHECK (wait (child) == 81, "wait for child");
+  check_buf ('P', "parent");
+  check_bytes (keep, sizeof keep, 'k', "parent");
+}
@@ -0,0 +1,40 @@
+/* Checks that a file's mapping and the read and write system
+   calls see each other's changes while the mapping is live,
+   without an munmap in between. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+
+void
+test_main (void)
+{
+  size_t size = strlen (sample);
+  int handle;
+  mapid_t map;
+  char buf[1024];
+
+  CHECK (create ("sample.txt", size), "create \"sample.txt\"");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, ACTUAL)) != MAP_FAILED, "mmap \"sample.txt\"");
+
+  /* write() must show up in the mapping. */
+  CHECK (write (handle, sample, size) == (int) size,
+         "write \"sample.txt\"");
+  if (memcmp (ACTUAL, sample, size))
+    fail ("mapping does not see data written by write()");
+
+  /* Stores through the mapping must show up in read(). */
+  memset (ACTUAL, 'x', size / 2);
+  seek (handle, 0);
+  CHECK (read (handle, buf, size) == (int) size, "read \"sample.txt\"");
+  if (memcmp (buf, ACTUAL, size))
+    fail ("read() does not see data stored through the mapping");
+
+  munmap (map);
+  close (handle);
+}
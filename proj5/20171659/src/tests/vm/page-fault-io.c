@@ -0,0 +1,100 @@
+/* Runs 2 child-linear processes, whose anonymous pages fault in
+   and out of swap, while this process does file I/O of its own:
+   it writes a file from a 1 MB buffer that is paged out between
+   rounds, reads the file back through a mapping, which faults on
+   file pages, and with read(), which faults on buffer pages while
+   it holds the file system lock.  Anonymous faults must neither
+   wait for nor deadlock with the file system. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define BUF_PAGES 256
+#define FILE_PAGES 32
+#define ROUND_CNT 4
+#define CHILD_CNT 2
+
+#define ACTUAL ((char *) 0x10000000)
+
+static char buf[BUF_PAGES][PAGE_SIZE];
+
+/* Returns byte J of page I of buf in round R. */
+static char
+buf_byte (int r, int i, int j)
+{
+  return r * 43 + i * 11 + j / 17;
+}
+
+/* Returns the page of buf that page I of the file is written from
+   in round R, spread over the whole buffer. */
+static int
+src_page (int r, int i)
+{
+  return (i * 7 + r) % BUF_PAGES;
+}
+
+/* Checks that P holds page I of the file as written in round R. */
+static void
+check_file_page (const char *p, int r, int i, const char *how)
+{
+  int j;
+
+  for (j = 0; j < PAGE_SIZE; j++)
+    if (p[j] != buf_byte (r, src_page (r, i), j))
+      fail ("byte %d of file page %d is wrong %s in round %d",
+            j, i, how, r);
+}
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int handle, r, i, j;
+
+  CHECK (create ("data", FILE_PAGES * PAGE_SIZE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK ((children[i] = exec ("child-linear")) != -1,
+           "exec \"child-linear\"");
+
+  msg ("do file I/O while the children page");
+  for (r = 0; r < ROUND_CNT; r++)
+    {
+      mapid_t map;
+
+      for (i = 0; i < BUF_PAGES; i++)
+        for (j = 0; j < PAGE_SIZE; j++)
+          buf[i][j] = buf_byte (r, i, j);
+
+      seek (handle, 0);
+      for (i = 0; i < FILE_PAGES; i++)
+        if (write (handle, buf[src_page (r, i)], PAGE_SIZE) != PAGE_SIZE)
+          fail ("write of file page %d failed in round %d", i, r);
+
+      if ((map = mmap (handle, ACTUAL)) == MAP_FAILED)
+        fail ("mmap failed in round %d", r);
+      for (i = 0; i < FILE_PAGES; i++)
+        check_file_page (ACTUAL + i * PAGE_SIZE, r, i, "in the mapping");
+      munmap (map);
+
+      /* Read into pages the file was not written from, so each
+         read faults them back in from swap. */
+      seek (handle, 0);
+      for (i = 0; i < FILE_PAGES; i++)
+        {
+          char *p = buf[(src_page (r, i) + BUF_PAGES / 2) % BUF_PAGES];
+
+          if (read (handle, p, PAGE_SIZE) != PAGE_SIZE)
+            fail ("read of file page %d failed in round %d", i, r);
+          check_file_page (p, r, i, "on reading");
+        }
+    }
+  close (handle);
+
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == 0x42, "wait for child %d", i);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-fault-io) begin
+(page-fault-io) create "data"
+(page-fault-io) open "data"
+(page-fault-io) exec "child-linear"
+(page-fault-io) exec "child-linear"
+(page-fault-io) do file I/O while the children page
+(page-fault-io) wait for child 0
+(page-fault-io) wait for child 1
+(page-fault-io) end
+EOF
+pass;
@@ -0,0 +1,76 @@
+/* Writes 2 MB of pages in bursts of 256 kB.  Between bursts the
+   process blocks on file I/O, which gives the background reclaimer
+   time to evict pages ahead of the next burst, and then checks the
+   burst before, whose pages the reclaimer may have just written to
+   swap.  Checks every page at the end. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define BURST_PAGES 64
+#define BURST_CNT 8
+
+static char buf[BURST_CNT][BURST_PAGES][PAGE_SIZE];
+static char io[2][2 * PAGE_SIZE];
+
+/* Returns byte J of page I of burst B. */
+static char
+page_byte (int b, int i, int j)
+{
+  return b * 61 + i * 7 + j / 13;
+}
+
+/* Checks that every page of burst B holds its data. */
+static void
+check_burst (int b)
+{
+  int i, j;
+
+  for (i = 0; i < BURST_PAGES; i++)
+    for (j = 0; j < PAGE_SIZE; j++)
+      if (buf[b][i][j] != page_byte (b, i, j))
+        fail ("byte %d of page %d of burst %d is wrong", j, i, b);
+}
+
+/* Writes io[0] to a file and reads it back into io[1], which
+   blocks on the disk while the reclaimer runs. */
+static void
+block_on_io (int handle, int b)
+{
+  memset (io[0], b, sizeof io[0]);
+  seek (handle, 0);
+  if (write (handle, io[0], sizeof io[0]) != (int) sizeof io[0])
+    fail ("write after burst %d failed", b);
+  seek (handle, 0);
+  if (read (handle, io[1], sizeof io[1]) != (int) sizeof io[1]
+      || memcmp (io[0], io[1], sizeof io[0]))
+    fail ("read after burst %d failed", b);
+}
+
+void
+test_main (void)
+{
+  int handle, b, i, j;
+
+  CHECK (create ("pause", 0), "create \"pause\"");
+  CHECK ((handle = open ("pause")) > 1, "open \"pause\"");
+
+  msg ("write bursts");
+  for (b = 0; b < BURST_CNT; b++)
+    {
+      for (i = 0; i < BURST_PAGES; i++)
+        for (j = 0; j < PAGE_SIZE; j++)
+          buf[b][i][j] = page_byte (b, i, j);
+      block_on_io (handle, b);
+      if (b > 0)
+        check_burst (b - 1);
+    }
+  close (handle);
+
+  msg ("check bursts");
+  for (b = 0; b < BURST_CNT; b++)
+    check_burst (b);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-kswapd) begin
+(page-kswapd) create "pause"
+(page-kswapd) open "pause"
+(page-kswapd) write bursts
+(page-kswapd) check bursts
+(page-kswapd) end
+EOF
+pass;
@@ -0,0 +1,87 @@
+/* Streams 2 MB of cold pages through memory while a small set of
+   hot pages is touched over and over, so that the hot pages keep
+   being promoted and the cold ones demoted and evicted.  The cold
+   pages are streamed twice, writing them the first time and only
+   reading them the second, so that the second pass evicts clean
+   pages.  Checks that every page, hot or cold, keeps its data. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HOT_PAGES 16
+#define COLD_PAGES 512
+
+/* Hot pages are touched after every this many cold pages. */
+#define TOUCH_INTERVAL 8
+
+static char hot[HOT_PAGES][PAGE_SIZE];
+static char cold[COLD_PAGES][PAGE_SIZE];
+
+/* Number of times touch_hot() has run. */
+static int touch_cnt;
+
+/* Reads every hot page and bumps the counter at its start. */
+static void
+touch_hot (void)
+{
+  int i;
+
+  for (i = 0; i < HOT_PAGES; i++)
+    {
+      int *counter = (int *) hot[i];
+
+      if (*counter != touch_cnt)
+        fail ("hot page %d touched %d times, expected %d",
+              i, *counter, touch_cnt);
+      if (hot[i][PAGE_SIZE - 1] != (char) (i + 1))
+        fail ("hot page %d lost its data", i);
+      (*counter)++;
+    }
+  touch_cnt++;
+}
+
+/* Checks that cold page I holds what the first pass wrote. */
+static void
+check_cold (int i)
+{
+  int j;
+
+  if (*(int *) cold[i] != i)
+    fail ("cold page %d has index %d", i, *(int *) cold[i]);
+  for (j = sizeof (int); j < PAGE_SIZE; j++)
+    if (cold[i][j] != (char) (i * 7 + j))
+      fail ("byte %d of cold page %d is wrong", j, i);
+}
+
+void
+test_main (void)
+{
+  int i, j;
+
+  msg ("initialize hot pages");
+  for (i = 0; i < HOT_PAGES; i++)
+    hot[i][PAGE_SIZE - 1] = i + 1;
+
+  msg ("write cold pages");
+  for (i = 0; i < COLD_PAGES; i++)
+    {
+      *(int *) cold[i] = i;
+      for (j = sizeof (int); j < PAGE_SIZE; j++)
+        cold[i][j] = i * 7 + j;
+      if (i % TOUCH_INTERVAL == 0)
+        touch_hot ();
+    }
+
+  msg ("read cold pages");
+  for (i = 0; i < COLD_PAGES; i++)
+    {
+      check_cold (i);
+      if (i % TOUCH_INTERVAL == 0)
+        touch_hot ();
+    }
+
+  msg ("verify hot pages");
+  touch_hot ();
+}
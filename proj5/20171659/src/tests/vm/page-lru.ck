@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-lru) begin
+(page-lru) initialize hot pages
+(page-lru) write cold pages
+(page-lru) read cold pages
+(page-lru) verify hot pages
+(page-lru) end
+EOF
+pass;
@@ -0,0 +1,129 @@
+/* Builds a small directory tree, then streams 768 kB of file data
+   through the buffer cache twice, which would push every
+   directory and inode block out of a cache that did not keep
+   metadata apart.  Then walks the tree: every directory must still
+   list its files, and every file must be found by name and hold
+   its data.  The file data passes through a buffer that is paged
+   out meanwhile. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define DIR_CNT 4
+#define FILE_CNT 8
+#define FILE_SIZE 600
+#define STREAM_PAGES 192
+
+static char stream[STREAM_PAGES][PAGE_SIZE];
+static char data[FILE_SIZE];
+
+/* Fills data with the contents of file F of directory D. */
+static void
+make_data (int d, int f)
+{
+  int i;
+
+  for (i = 0; i < FILE_SIZE; i++)
+    data[i] = d * 37 + f * 5 + i;
+}
+
+/* Stores the name of file F of directory D into NAME. */
+static void
+file_name (char name[32], int d, int f)
+{
+  snprintf (name, 32, "meta/d%d/f%d", d, f);
+}
+
+/* Writes the stream file from the buffer, in generation GEN, and
+   reads it back into the buffer. */
+static void
+stream_file (int gen)
+{
+  int handle, i, j;
+
+  CHECK ((handle = open ("stream")) > 1, "open \"stream\"");
+  for (i = 0; i < STREAM_PAGES; i++)
+    {
+      memset (stream[i], i + gen, PAGE_SIZE);
+      if (write (handle, stream[i], PAGE_SIZE) != PAGE_SIZE)
+        fail ("write of stream page %d failed", i);
+    }
+  memset (stream, 0, sizeof stream);
+  seek (handle, 0);
+  for (i = 0; i < STREAM_PAGES; i++)
+    {
+      if (read (handle, stream[i], PAGE_SIZE) != PAGE_SIZE)
+        fail ("read of stream page %d failed", i);
+      for (j = 0; j < PAGE_SIZE; j++)
+        if (stream[i][j] != (char) (i + gen))
+          fail ("byte %d of stream page %d is wrong", j, i);
+    }
+  close (handle);
+}
+
+void
+test_main (void)
+{
+  char name[32];
+  int d, f;
+
+  msg ("build tree");
+  if (!mkdir ("meta"))
+    fail ("mkdir \"meta\" failed");
+  for (d = 0; d < DIR_CNT; d++)
+    {
+      snprintf (name, sizeof name, "meta/d%d", d);
+      if (!mkdir (name))
+        fail ("mkdir \"%s\" failed", name);
+      for (f = 0; f < FILE_CNT; f++)
+        {
+          int handle;
+
+          file_name (name, d, f);
+          make_data (d, f);
+          if (!create (name, 0) || (handle = open (name)) < 2)
+            fail ("create \"%s\" failed", name);
+          if (write (handle, data, FILE_SIZE) != FILE_SIZE)
+            fail ("write \"%s\" failed", name);
+          close (handle);
+        }
+    }
+
+  CHECK (create ("stream", 0), "create \"stream\"");
+  stream_file (0);
+  stream_file (1);
+
+  msg ("walk tree");
+  for (d = 0; d < DIR_CNT; d++)
+    {
+      char entry[READDIR_MAX_LEN + 1];
+      int handle, cnt = 0;
+
+      snprintf (name, sizeof name, "meta/d%d", d);
+      if ((handle = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      while (readdir (handle, entry))
+        cnt++;
+      close (handle);
+      if (cnt != FILE_CNT)
+        fail ("\"%s\" lists %d entries, not %d", name, cnt, FILE_CNT);
+
+      for (f = 0; f < FILE_CNT; f++)
+        {
+          char buf[FILE_SIZE];
+
+          file_name (name, d, f);
+          make_data (d, f);
+          if ((handle = open (name)) < 2)
+            fail ("open \"%s\" failed", name);
+          if (read (handle, buf, FILE_SIZE) != FILE_SIZE
+              || memcmp (buf, data, FILE_SIZE))
+            fail ("\"%s\" does not hold its data", name);
+          close (handle);
+        }
+    }
+}
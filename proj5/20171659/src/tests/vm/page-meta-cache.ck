@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-meta-cache) begin
+(page-meta-cache) build tree
+(page-meta-cache) create "stream"
+(page-meta-cache) open "stream"
+(page-meta-cache) open "stream"
+(page-meta-cache) walk tree
+(page-meta-cache) end
+EOF
+pass;
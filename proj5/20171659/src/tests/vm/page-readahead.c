@@ -0,0 +1,66 @@
+/* Swaps out 2 MB of pages, then faults them back in in orders
+   that make swap read-ahead bring in neighbouring pages: forward,
+   one page in eight so that read-ahead pages are left unused, and
+   forward again rewriting each page, which dirties pages that
+   read-ahead brought in.  Checks that every page keeps its data. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 512
+
+/* One more than the pages read-ahead brings in after a fault. */
+#define STRIDE 8
+
+static int buf[PAGE_CNT][PAGE_SIZE / sizeof (int)];
+
+/* Fills page I with values derived from I and GEN. */
+static void
+fill_page (int i, int gen)
+{
+  size_t j;
+
+  for (j = 0; j < PAGE_SIZE / sizeof (int); j++)
+    buf[i][j] = i * 1021 + j * 3 + gen;
+}
+
+/* Checks that page I holds what fill_page (I, GEN) wrote. */
+static void
+check_page (int i, int gen)
+{
+  size_t j;
+
+  for (j = 0; j < PAGE_SIZE / sizeof (int); j++)
+    if (buf[i][j] != (int) (i * 1021 + j * 3 + gen))
+      fail ("word %zu of page %d is wrong", j, i);
+}
+
+void
+test_main (void)
+{
+  int i;
+
+  msg ("write pages");
+  for (i = 0; i < PAGE_CNT; i++)
+    fill_page (i, 0);
+
+  msg ("read pages forward");
+  for (i = 0; i < PAGE_CNT; i++)
+    check_page (i, 0);
+
+  msg ("read one page in %d", STRIDE);
+  for (i = 0; i < PAGE_CNT; i += STRIDE)
+    check_page (i, 0);
+
+  msg ("rewrite pages forward");
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      check_page (i, 0);
+      fill_page (i, 1);
+    }
+
+  msg ("read pages backward");
+  for (i = PAGE_CNT - 1; i >= 0; i--)
+    check_page (i, 1);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-readahead) begin
+(page-readahead) write pages
+(page-readahead) read pages forward
+(page-readahead) read one page in 8
+(page-readahead) rewrite pages forward
+(page-readahead) read pages backward
+(page-readahead) end
+EOF
+pass;
@@ -0,0 +1,105 @@
+/* Fills the kernel's caches with a file, then asks for more user
+   memory than is left, so that the shrinkers must give frames
+   back.  Writes 512 kB of file data through the buffer cache,
+   maps the file and reads every page of it into the page cache,
+   dirtying one page in four, and then writes 1.5 MB of anonymous
+   memory.  Checks the anonymous pages, the mapping and, after
+   unmapping, the file itself. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define FILE_PAGES 128
+#define ANON_PAGES 384
+
+#define ACTUAL ((char *) 0x10000000)
+
+static char anon[ANON_PAGES][PAGE_SIZE];
+static char page[PAGE_SIZE];
+
+/* Returns byte J of page I of the file as first written. */
+static char
+file_byte (int i, int j)
+{
+  return i * 31 + j / 7;
+}
+
+/* Returns byte J of page I of the file once the mapping wrote to
+   one page in four. */
+static char
+mapped_byte (int i, int j)
+{
+  return i % 4 == 0 ? (char) ~i : file_byte (i, j);
+}
+
+/* Checks that page I of the file, at P, holds its mapped bytes. */
+static void
+check_file_page (const char *p, int i, const char *how)
+{
+  int j;
+
+  for (j = 0; j < PAGE_SIZE; j++)
+    if (p[j] != mapped_byte (i, j))
+      fail ("byte %d of file page %d is wrong %s", j, i, how);
+}
+
+void
+test_main (void)
+{
+  int handle;
+  mapid_t map;
+  int i, j;
+
+  CHECK (create ("cache", 0), "create \"cache\"");
+  CHECK ((handle = open ("cache")) > 1, "open \"cache\"");
+
+  msg ("write file");
+  for (i = 0; i < FILE_PAGES; i++)
+    {
+      for (j = 0; j < PAGE_SIZE; j++)
+        page[j] = file_byte (i, j);
+      if (write (handle, page, PAGE_SIZE) != PAGE_SIZE)
+        fail ("write of page %d failed", i);
+    }
+
+  CHECK ((map = mmap (handle, ACTUAL)) != MAP_FAILED, "mmap \"cache\"");
+  msg ("read and dirty mapping");
+  for (i = 0; i < FILE_PAGES; i++)
+    {
+      char *p = ACTUAL + i * PAGE_SIZE;
+
+      for (j = 0; j < PAGE_SIZE; j++)
+        if (p[j] != file_byte (i, j))
+          fail ("byte %d of mapped page %d is wrong", j, i);
+      if (i % 4 == 0)
+        memset (p, ~i, PAGE_SIZE);
+    }
+
+  msg ("write anonymous pages");
+  for (i = 0; i < ANON_PAGES; i++)
+    memset (anon[i], i * 3, PAGE_SIZE);
+
+  msg ("check anonymous pages");
+  for (i = 0; i < ANON_PAGES; i++)
+    for (j = 0; j < PAGE_SIZE; j++)
+      if (anon[i][j] != (char) (i * 3))
+        fail ("byte %d of anonymous page %d is wrong", j, i);
+
+  msg ("check mapping");
+  for (i = 0; i < FILE_PAGES; i++)
+    check_file_page (ACTUAL + i * PAGE_SIZE, i, "in the mapping");
+  munmap (map);
+
+  msg ("check file");
+  seek (handle, 0);
+  for (i = 0; i < FILE_PAGES; i++)
+    {
+      if (read (handle, page, PAGE_SIZE) != PAGE_SIZE)
+        fail ("read of page %d failed", i);
+      check_file_page (page, i, "on reading");
+    }
+  close (handle);
+}
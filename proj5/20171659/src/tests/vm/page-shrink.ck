@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-shrink) begin
+(page-shrink) create "cache"
+(page-shrink) open "cache"
+(page-shrink) write file
+(page-shrink) mmap "cache"
+(page-shrink) read and dirty mapping
+(page-shrink) write anonymous pages
+(page-shrink) check anonymous pages
+(page-shrink) check mapping
+(page-shrink) check file
+(page-shrink) end
+EOF
+pass;
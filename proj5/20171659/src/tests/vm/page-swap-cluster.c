@@ -0,0 +1,63 @@
+/* Writes 2 MB of pages, which go to swap in clusters of adjacent
+   slots, then rewrites every other page, which faults it in and
+   frees its slot in the middle of its cluster.  The later clusters
+   must then be written around those holes.  Reads everything back
+   in reverse, rewrites one page in three and reads everything
+   forward again, checking every page each time. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 512
+
+static int buf[PAGE_CNT][PAGE_SIZE / sizeof (int)];
+static int gens[PAGE_CNT];
+
+/* Fills page I with values derived from I and GEN. */
+static void
+fill_page (int i, int gen)
+{
+  size_t j;
+
+  for (j = 0; j < PAGE_SIZE / sizeof (int); j++)
+    buf[i][j] = i * 1009 + j * 5 + gen * 7919;
+  gens[i] = gen;
+}
+
+/* Checks that page I holds what it was last filled with. */
+static void
+check_page (int i)
+{
+  size_t j;
+
+  for (j = 0; j < PAGE_SIZE / sizeof (int); j++)
+    if (buf[i][j] != (int) (i * 1009 + j * 5 + gens[i] * 7919))
+      fail ("word %zu of page %d is wrong", j, i);
+}
+
+void
+test_main (void)
+{
+  int i;
+
+  msg ("write pages");
+  for (i = 0; i < PAGE_CNT; i++)
+    fill_page (i, 0);
+
+  msg ("rewrite every other page");
+  for (i = 1; i < PAGE_CNT; i += 2)
+    fill_page (i, 1);
+
+  msg ("read pages backward");
+  for (i = PAGE_CNT - 1; i >= 0; i--)
+    check_page (i);
+
+  msg ("rewrite one page in three");
+  for (i = 0; i < PAGE_CNT; i += 3)
+    fill_page (i, 2);
+
+  msg ("read pages forward");
+  for (i = 0; i < PAGE_CNT; i++)
+    check_page (i);
+}
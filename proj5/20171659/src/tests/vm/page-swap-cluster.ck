@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-swap-cluster) begin
+(page-swap-cluster) write pages
+(page-swap-cluster) rewrite every other page
+(page-swap-cluster) read pages backward
+(page-swap-cluster) rewrite one page in three
+(page-swap-cluster) read pages forward
+(page-swap-cluster) end
+EOF
+pass;
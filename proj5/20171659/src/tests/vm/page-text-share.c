@@ -0,0 +1,24 @@
+/* Runs 3 child-text processes at once.  They run the same
+   executable, so they share its read-only text pages, and they
+   use enough memory to evict those pages while they do. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 3
+
+void
+test_main (void)
+{
+  static const char *cmds[CHILD_CNT] =
+    { "child-text one", "child-text two", "child-text three" };
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    CHECK ((children[i] = exec (cmds[i])) != -1, "exec \"%s\"", cmds[i]);
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    CHECK (wait (children[i]) == 0x51, "wait for child %d", i);
+}
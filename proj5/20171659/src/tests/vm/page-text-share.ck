@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-text-share) begin
+(page-text-share) exec "child-text one"
+(page-text-share) exec "child-text two"
+(page-text-share) exec "child-text three"
+(page-text-share) wait for child 0
+(page-text-share) wait for child 1
+(page-text-share) wait for child 2
+(page-text-share) end
+EOF
+pass;
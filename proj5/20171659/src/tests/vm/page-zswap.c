@@ -0,0 +1,82 @@
+/* Swaps out 3 MB of pages of three kinds: text-like pages that
+   compress well, random pages that do not compress at all, and
+   pages that are three-eighths random, which compress just enough
+   to be kept compressed and fill the compressed pool until it has
+   to write pages back.  Reads every page back, rewrites them all with
+   new contents and reads them back again. */
+
+#include <string.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 768
+
+static char buf[PAGE_CNT][PAGE_SIZE];
+
+/* Fills PAGE with the contents page I has in generation GEN. */
+static void
+make_page (char *page, int i, int gen)
+{
+  static const char text[] = "zswap stores this page compressed. ";
+  size_t random_size, j;
+
+  for (j = 0; j < PAGE_SIZE; j++)
+    page[j] = text[j % (sizeof text - 1)] ^ gen;
+  memcpy (page, &i, sizeof i);
+
+  switch (i % 4)
+    {
+    case 0:
+      random_size = 0;
+      break;
+    case 1:
+      random_size = PAGE_SIZE;
+      break;
+    default:
+      random_size = PAGE_SIZE / 8 * 3;
+      break;
+    }
+  if (random_size > 0)
+    {
+      struct arc4 arc4;
+      int key[2] = { i, gen };
+
+      arc4_init (&arc4, key, sizeof key);
+      arc4_crypt (&arc4, page + PAGE_SIZE - random_size, random_size);
+    }
+}
+
+/* Checks that page I of buf holds its contents in generation GEN. */
+static void
+check_page (int i, int gen)
+{
+  char expected[PAGE_SIZE];
+
+  make_page (expected, i, gen);
+  if (memcmp (buf[i], expected, PAGE_SIZE))
+    fail ("page %d differs from what was written", i);
+}
+
+void
+test_main (void)
+{
+  int i;
+
+  msg ("write pages");
+  for (i = 0; i < PAGE_CNT; i++)
+    make_page (buf[i], i, 0);
+
+  msg ("read pages");
+  for (i = 0; i < PAGE_CNT; i++)
+    check_page (i, 0);
+
+  msg ("rewrite pages");
+  for (i = 0; i < PAGE_CNT; i++)
+    make_page (buf[i], i, 1);
+
+  msg ("read pages again");
+  for (i = PAGE_CNT - 1; i >= 0; i--)
+    check_page (i, 1);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-zswap) begin
+(page-zswap) write pages
+(page-zswap) read pages
+(page-zswap) rewrite pages
+(page-zswap) read pages again
+(page-zswap) end
+EOF
+pass;
@@ -34,9 +34,15 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "filesys/buffer_cache.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/swap.h"
+#include "vm/page_cache.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -45,6 +51,9 @@ uint32_t *init_page_dir;
 /* -f: Format the file system? */
 static bool format_filesys;
 
+/* -f=compact: Format it with a compact inode table? */
+static bool compact_inodes;
+
 /* -filesys, -scratch, -swap: Names of block devices to use,
    overriding the defaults. */
 static const char *filesys_bdev_name;
@@ -120,11 +129,21 @@ main (void)
   serial_init_queue ();
   timer_calibrate ();
 
+#ifdef VM
+  /* The file system consults the page cache from the start. */
+  pcache_init ();
+#endif
+
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
   locate_block_devices ();
-  filesys_init (format_filesys);
+  filesys_init (format_filesys, compact_inodes);
+#endif
+
+#ifdef VM
+  lru_list_init ();
+  swap_init ();
 #endif
 
   printf ("Boot complete.\n");
@@ -242,7 +261,15 @@ parse_options (char **argv)
         shutdown_configure (SHUTDOWN_REBOOT);
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
-        format_filesys = true;
+        {
+          format_filesys = true;
+          if (value != NULL && !strcmp (value, "compact"))
+            compact_inodes = true;
+          else if (value != NULL)
+            PANIC ("unknown format `%s' (use -h for help)", value);
+        }
+      else if (!strcmp (name, "-bcmeta"))
+        bc_set_meta_floor (atoi (value));
       else if (!strcmp (name, "-filesys"))
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
@@ -371,6 +398,8 @@ usage (void)
           "  -r                 Reboot after actions.\n"
 #ifdef FILESYS
           "  -f                 Format file system device during startup.\n"
+          "  -f=compact         Format it with several inodes per sector.\n"
+          "  -bcmeta=N          Keep N buffer cache slots for metadata.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
 #ifdef VM
@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -36,6 +37,9 @@ struct pool
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Caches to shrink when a pool runs out. */
+static struct list shrinkers;
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
@@ -59,13 +63,16 @@ palloc_init (size_t user_page_limit)
   init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
   init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
              user_pages, "user pool");
+  list_init (&shrinkers);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
+   available, the registered shrinkers for the pool are asked to
+   give some back first, unless PAL_NOSHRINK is set.  If that does
+   not help, returns a null pointer, unless PAL_ASSERT is set in
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
@@ -81,6 +88,14 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
   lock_release (&pool->lock);
 
+  if (page_idx == BITMAP_ERROR && !(flags & PAL_NOSHRINK)
+      && palloc_shrink (flags & PAL_USER, page_cnt) > 0)
+    {
+      lock_acquire (&pool->lock);
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+      lock_release (&pool->lock);
+    }
+
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
   else
@@ -148,6 +163,67 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_pages (void)
+{
+  return bitmap_size (user_pool.used_map);
+}
+
+/* Returns the number of free pages in the user pool. */
+size_t
+palloc_user_free (void)
+{
+  size_t cnt;
+
+  lock_acquire (&user_pool.lock);
+  cnt = bitmap_count (user_pool.used_map, 0, bitmap_size (user_pool.used_map),
+                      false);
+  lock_release (&user_pool.lock);
+  return cnt;
+}
+
+/* Returns the index of user pool page PAGE within the pool, from
+   0 up to palloc_user_pages(). */
+size_t
+palloc_user_index (void *page)
+{
+  ASSERT (page_from_pool (&user_pool, page));
+  return pg_no (page) - pg_no (user_pool.base);
+}
+
+/* Has SHRINKER called whenever its pool runs out of pages. */
+void
+palloc_register_shrinker (struct shrinker *shrinker)
+{
+  list_push_back (&shrinkers, &shrinker->elem);
+}
+
+/* Asks the shrinkers of the user pool if USER, otherwise of the
+   kernel pool, for PAGE_CNT pages, stopping once they have freed
+   that many.  Returns the number freed. */
+size_t
+palloc_shrink (bool user, size_t page_cnt)
+{
+  struct list_elem *e;
+  size_t freed = 0;
+
+  /* Shrinkers may sleep. */
+  if (intr_context () || intr_get_level () == INTR_OFF)
+    return 0;
+
+  for (e = list_begin (&shrinkers); e != list_end (&shrinkers);
+       e = list_next (e))
+    {
+      struct shrinker *shrinker = list_entry (e, struct shrinker, elem);
+      if (shrinker->user == user)
+        freed += shrinker->shrink (page_cnt - freed);
+      if (freed >= page_cnt)
+        break;
+    }
+  return freed;
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -1,6 +1,8 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <list.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -8,7 +10,20 @@ enum palloc_flags
   {
     PAL_ASSERT = 001,           /* Panic on failure. */
     PAL_ZERO = 002,             /* Zero page contents. */
-    PAL_USER = 004              /* User page. */
+    PAL_USER = 004,             /* User page. */
+    PAL_NOSHRINK = 010          /* Fail rather than shrink caches. */
+  };
+
+/* A cache that gives memory back when a pool runs out.  SHRINK
+   is asked to free about PAGE_CNT pages' worth and returns how
+   many it freed.  It may be called from any allocation outside an
+   interrupt handler, so it must not wait on a lock that the
+   allocating thread could hold. */
+struct shrinker
+  {
+    struct list_elem elem;
+    size_t (*shrink) (size_t page_cnt);
+    bool user;                  /* Frees user pool pages? */
   };
 
 void palloc_init (size_t user_page_limit);
@@ -16,5 +31,10 @@ void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+size_t palloc_user_pages (void);
+size_t palloc_user_free (void);
+size_t palloc_user_index (void *);
+void palloc_register_shrinker (struct shrinker *);
+size_t palloc_shrink (bool user, size_t page_cnt);
 
 #endif /* threads/palloc.h */
@@ -483,6 +483,12 @@ init_thread (struct thread *t, const char *name, int priority)
   list_init(&t->file_descriptors);
   t->cwd = NULL;
   t->executing_file = NULL;
+#ifdef VM
+  list_init(&t->mmap_list);
+  t->next_mapid = 1;
+  t->pin_start = NULL;
+  t->pin_size = 0;
+#endif
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
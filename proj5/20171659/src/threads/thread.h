@@ -6,6 +6,10 @@
 #include <stdint.h>
 #include "synch.h"
 #include "filesys/directory.h"
+#ifdef VM
+#include <hash.h>
+#include "vm/page.h"
+#endif
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -114,6 +118,17 @@ struct thread
     struct list file_descriptors; 
     struct dir *cwd;
     struct file *executing_file;
+
+#ifdef VM
+    /* modified : vm */
+    struct hash vm;                     /* Supplemental page table. */
+    struct list mmap_list;              /* Memory mapped files. */
+    int next_mapid;                     /* Id for the next mmap(). */
+    void *esp;                          /* User stack pointer on entry
+                                           to the kernel. */
+    const void *pin_start;              /* User buffer being pinned, */
+    size_t pin_size;                    /* and how much of it is. */
+#endif
   };
 
 /* If false (default), use round-robin scheduler.
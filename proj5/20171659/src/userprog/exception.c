@@ -6,12 +6,21 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "lib/user/syscall.h"
+#ifdef VM
+#include "threads/synch.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
+#ifdef VM
+static void fault_exit (void) NO_RETURN;
+#endif
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -150,6 +159,35 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  if(is_kernel_vaddr(fault_addr) || fault_addr == NULL)
+    fault_exit();
+
+  struct vm_entry *vme = find_vme(fault_addr);
+  void *esp = user ? f->esp : thread_current()->esp;
+  bool load = false;
+
+  /* A fault on a page that is there means a bad write, unless the
+     page is writable and only shared read-only since fork(). */
+  if(!not_present) {
+    if(vme == NULL || !write || !vme->writable || !unshare_page(vme))
+      fault_exit();
+    return;
+  }
+
+  /* Load the page from wherever the supplemental page table says
+     it is, or grow the stack if the access is just below the
+     stack pointer. */
+  if(vme != NULL)
+    load = handle_mm_fault(vme);
+  else if(fault_addr >= esp - STACK_GROW_LIMIT)
+    load = expand_stack(fault_addr);
+
+  if(!load)
+    fault_exit();
+  return;
+#endif
+
    /*modifed: add exit(-1) case*/
   if(user == false || is_kernel_vaddr(fault_addr) || not_present){
      exit(-1);
@@ -166,3 +204,15 @@ page_fault (struct intr_frame *f)
   kill (f);
 }
 
+#ifdef VM
+/* Kills the current process after a fault it cannot recover
+   from, first dropping the file system lock if a system call
+   faulted while holding it. */
+static void
+fault_exit (void)
+{
+  if (lock_held_by_current_thread (&file_lock))
+    lock_release (&file_lock);
+  exit (-1);
+}
+#endif
@@ -20,10 +20,30 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#ifdef VM
+#include "vm/page.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+#include "vm/page_cache.h"
+#include <bitmap.h>
+#endif
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
+#ifdef VM
+/* What fork() hands to the child it creates. */
+struct fork_args
+  {
+    struct thread *parent;      /* Process being forked. */
+    struct intr_frame if_;      /* Its registers at the fork() call. */
+    bool success;               /* Set by the child once it is a copy. */
+  };
+
+static thread_func fork_process NO_RETURN;
+static bool duplicate_files (struct thread *parent);
+#endif
+
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
@@ -90,6 +110,11 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
+
+#ifdef VM
+  /* initialize hash */
+  vm_init (&thread_current ()->vm);
+#endif
   
   success = load (file_name, &if_.eip, &if_.esp);
 
@@ -113,6 +138,105 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+#ifdef VM
+/* Starts a new process that is a copy of the current one and
+   resumes from IF_, the interrupt frame of the fork() system call,
+   with 0 as fork()'s return value.  Memory in use is shared
+   copy-on-write instead of being copied.  Returns the new process's
+   thread id, or TID_ERROR if it cannot be created. */
+tid_t
+process_fork (const struct intr_frame *if_)
+{
+  struct fork_args args;
+  tid_t tid;
+
+  args.parent = thread_current ();
+  args.if_ = *if_;
+  args.success = false;
+
+  tid = thread_create (thread_name (), PRI_DEFAULT, fork_process, &args);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+
+  /* The child reads ARGS and this process's state until it is a
+     complete copy. */
+  sema_down (&thread_current ()->sema_sync);
+  if (!args.success)
+    {
+      process_wait (tid);
+      return TID_ERROR;
+    }
+  return tid;
+}
+
+/* A thread function that makes the new thread a copy of the
+   process that forked it and returns to user mode. */
+static void
+fork_process (void *args_)
+{
+  struct fork_args *args = args_;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_ = args->if_;
+  bool success;
+
+  vm_init (&cur->vm);
+  cur->pagedir = pagedir_create ();
+  success = cur->pagedir != NULL;
+  if (success)
+    {
+      process_activate ();
+      lock_acquire (&file_lock);
+      success = duplicate_files (args->parent) && vm_copy (args->parent);
+      lock_release (&file_lock);
+    }
+
+  args->success = success;
+  sema_up (&cur->parent->sema_sync);
+  if (!success)
+    exit (-1);
+
+  /* The child's fork() returns 0. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Gives the current process, which fork() is creating, its own
+   copies of PARENT's open files, working directory and executable.
+   A copied file starts at the same position.  Returns false if
+   memory is short; whatever was copied is closed on exit. */
+static bool
+duplicate_files (struct thread *parent)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  if (parent->cwd != NULL
+      && (cur->cwd = dir_reopen (parent->cwd)) == NULL)
+    return false;
+  if (parent->executing_file != NULL
+      && (cur->executing_file = file_duplicate (parent->executing_file)) == NULL)
+    return false;
+
+  for (e = list_begin (&parent->file_descriptors);
+       e != list_end (&parent->file_descriptors); e = list_next (e))
+    {
+      struct file_desc *desc = list_entry (e, struct file_desc, elem);
+      struct file_desc *copy = palloc_get_page (0);
+
+      if (copy == NULL)
+        return false;
+      copy->id = desc->id;
+      copy->file = file_duplicate (desc->file);
+      copy->dir = desc->dir != NULL ? dir_reopen (desc->dir) : NULL;
+      list_push_back (&cur->file_descriptors, &copy->elem);
+      if (copy->file == NULL || (desc->dir != NULL && copy->dir == NULL))
+        return false;
+    }
+  return true;
+}
+#endif
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -152,6 +276,31 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+#ifdef VM
+  /* Unmap files and free the supplemental page table while the
+     page directory still exists, so that it does not free frames
+     that belong to the page cache or the frame table. */
+  if (cur->pagedir != NULL)
+    {
+      bool held;
+
+      /* A fault may have killed the process partway through
+         pinning a system call's buffer. */
+      if (cur->pin_size > 0)
+        unpin_user_pages (cur->pin_start, cur->pin_size);
+
+      held = lock_held_by_current_thread (&file_lock);
+      if (!held)
+        lock_acquire (&file_lock);
+      while (!list_empty (&cur->mmap_list))
+        do_munmap (list_entry (list_front (&cur->mmap_list),
+                               struct mmap_file, elem));
+      if (!held)
+        lock_release (&file_lock);
+      vm_destroy (&cur->vm);
+    }
+#endif
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -503,6 +652,29 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Only record where the page comes from.  It is read in by
+         handle_mm_fault() on its first access. */
+      struct vm_entry *vme = malloc (sizeof *vme);
+      if (vme == NULL)
+        return false;
+      vme->type = VM_BIN;
+      vme->vaddr = upage;
+      vme->writable = writable;
+      vme->is_loaded = false;
+      vme->evicting = NULL;
+      vme->swapcache = NULL;
+      vme->swap_slot = BITMAP_ERROR;
+      vme->file = file;
+      vme->offset = ofs;
+      vme->read_bytes = page_read_bytes;
+      vme->zero_bytes = page_zero_bytes;
+      if (!insert_vme (&thread_current ()->vm, vme))
+        {
+          free (vme);
+          return false;
+        }
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -522,10 +694,12 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
       zero_bytes -= page_zero_bytes;
+      ofs += page_read_bytes;
       upage += PGSIZE;
     }
   return true;
@@ -536,6 +710,40 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 setup_stack (void **esp) 
 {
+#ifdef VM
+  struct vm_entry *vme;
+  struct page *kpage;
+
+  vme = malloc (sizeof *vme);
+  if (vme == NULL)
+    return false;
+  vme->type = VM_ANON;
+  vme->vaddr = ((uint8_t *) PHYS_BASE) - PGSIZE;
+  vme->writable = true;
+  vme->is_loaded = true;
+  vme->evicting = NULL;
+  vme->swapcache = NULL;
+  vme->swap_slot = BITMAP_ERROR;
+  vme->file = NULL;
+  if (!insert_vme (&thread_current ()->vm, vme))
+    {
+      free (vme);
+      return false;
+    }
+
+  kpage = alloc_page (PAL_USER | PAL_ZERO);
+  if (kpage == NULL)
+    return false;
+  page_add_vme (kpage, vme);
+  if (!install_page (vme->vaddr, kpage->kaddr, true))
+    {
+      free_page (kpage->kaddr);
+      return false;
+    }
+  unpin_page (kpage);
+  *esp = PHYS_BASE;
+  return true;
+#else
   uint8_t *kpage;
   bool success = false;
 
@@ -549,6 +757,7 @@ setup_stack (void **esp)
         palloc_free_page (kpage);
     }
   return success;
+#endif
 }
 
 /* Adds a mapping from user virtual address UPAGE to kernel
@@ -570,3 +779,144 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+
+#ifdef VM
+/* Brings in the page that VME describes, after a page fault on
+   it.  Returns false if the page cannot be loaded. */
+bool
+handle_mm_fault (struct vm_entry *vme)
+{
+  struct page *page;
+  bool success = true;
+  bool readahead = false;
+  bool held;
+
+  /* Mapped file pages are the page cache's own frames, and the
+     page cache maps them.  Only the paths that read a file take
+     the file system lock, which a system call faulting on its
+     buffer may already hold. */
+  if (vme->type == VM_FILE)
+    {
+      held = lock_held_by_current_thread (&file_lock);
+      if (!held)
+        lock_acquire (&file_lock);
+      success = pcache_map (vme);
+      if (!held)
+        lock_release (&file_lock);
+      return success;
+    }
+
+  /* A page on its way out must reach swap before it can come back.
+     If swap was full, it is mapped again and the access can retry. */
+  wait_on_page_eviction (vme);
+  if (vme->is_loaded)
+    return true;
+
+  /* A page read ahead into the swap cache is already in memory, and
+     so is a read-only page of an executable that another process
+     running it has faulted in. */
+  if (vme->type == VM_ANON)
+    page = swapcache_take (vme);
+  else
+    page = vme->writable ? NULL : find_text_page (vme);
+
+  if (page != NULL)
+    {
+      if (vme->type == VM_ANON)
+        {
+          swap_free (vme->swap_slot);
+          vme->swap_slot = BITMAP_ERROR;
+        }
+    }
+  else
+    {
+      /* get a physical memory */
+      page = alloc_page (PAL_USER);
+      if (page == NULL)
+        return false;
+      page_add_vme (page, vme);
+
+      if (vme->type == VM_BIN)
+        {
+          held = lock_held_by_current_thread (&file_lock);
+          if (!held)
+            lock_acquire (&file_lock);
+          success = load_file (page->kaddr, vme);
+          if (!held)
+            lock_release (&file_lock);
+          if (success && !vme->writable)
+            add_text_page (page, vme);
+        }
+      else
+        {
+          swap_in (vme->swap_slot, page->kaddr);
+          vme->swap_slot = BITMAP_ERROR;
+          readahead = true;
+        }
+    }
+
+  /* set a page table. if fail, free the physical memory unless
+     another process maps it */
+  if (!success || !install_page (vme->vaddr, page->kaddr, vme->writable))
+    {
+      drop_page (page, vme);
+      return false;
+    }
+  unpin_page (page);
+
+  vme->is_loaded = true;
+
+  /* Its neighbours are likely to be faulted back in next. */
+  if (readahead)
+    swap_readahead (vme);
+  return true;
+}
+
+/* Grows the stack down to the page holding ADDR.  Returns false
+   if that would make the stack larger than MAX_STACK_SIZE or
+   memory is short. */
+bool
+expand_stack (void *addr)
+{
+  struct vm_entry *vme;
+  struct page *stack_page;
+
+  /* check stack is fulled */
+  if ((size_t) (PHYS_BASE - pg_round_down (addr)) > MAX_STACK_SIZE)
+    return false;
+
+  vme = malloc (sizeof *vme);
+  if (vme == NULL)
+    return false;
+  vme->type = VM_ANON;
+  vme->vaddr = pg_round_down (addr);
+  vme->writable = true;
+  vme->is_loaded = true;
+  vme->evicting = NULL;
+  vme->swapcache = NULL;
+  vme->swap_slot = BITMAP_ERROR;
+  vme->file = NULL;
+  if (!insert_vme (&thread_current ()->vm, vme))
+    {
+      free (vme);
+      return false;
+    }
+
+  stack_page = alloc_page (PAL_USER | PAL_ZERO);
+  if (stack_page == NULL)
+    {
+      delete_vme (&thread_current ()->vm, vme);
+      return false;
+    }
+  page_add_vme (stack_page, vme);
+
+  if (!install_page (vme->vaddr, stack_page->kaddr, true))
+    {
+      free_page (stack_page->kaddr);
+      delete_vme (&thread_current ()->vm, vme);
+      return false;
+    }
+  unpin_page (stack_page);
+  return true;
+}
+#endif
@@ -3,10 +3,27 @@
 
 #include "threads/thread.h"
 
+struct intr_frame;
+
+#ifdef VM
+/* Largest the user stack may grow. */
+#define MAX_STACK_SIZE (1 << 23)
+/* Farthest below the stack pointer an access may be and still
+   grow the stack, as PUSHA does. */
+#define STACK_GROW_LIMIT 32
+#endif
+
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
 
+#ifdef VM
+/*modified : vm*/
+bool expand_stack (void *addr);
+bool handle_mm_fault (struct vm_entry *vme);
+tid_t process_fork (const struct intr_frame *if_);
+#endif
+
 
 #endif /* userprog/process.h */
@@ -1,8 +1,12 @@
 #include <stdio.h>
 #include <syscall-nr.h>
 #include <string.h>
+#include <round.h>
+#include <limits.h>
 #include "lib/user/syscall.h"
+#include "devices/block.h"
 #include "devices/shutdown.h"
+#include "devices/timer.h"
 #include "threads/thread.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
@@ -11,6 +15,13 @@
 #include "filesys/off_t.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#ifdef VM
+#include "threads/malloc.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include <bitmap.h>
+#endif
 
 /* An open file. */
 struct file 
@@ -18,10 +29,21 @@ struct file
   struct inode *inode;        /* File's inode. */
   off_t pos;                  /* Current position. */
   bool deny_write;            /* Has file_deny_write() been called? */
+  bool direct;                /* Bypass the buffer cache? */
 };
 
 struct lock file_lock;
 
+/* modified5 : referenced from pintos doc */
+static bool 
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int error_code;
+  asm ("movl $1f, %0; movb %b2, %1; 1:"
+       : "=&a" (error_code), "=m" (*udst) : "q" (byte));
+  return error_code != -1;
+}
+
 static void syscall_handler (struct intr_frame *);
 
 void
@@ -42,6 +64,94 @@ check_vaddr(const void *vaddr)
   }
 }
 
+/* Keeps the frames under the SIZE bytes of user memory at BUFFER
+   resident while a system call copies to or from them, and WRITE
+   says which.  Without VM nothing is ever evicted. */
+static void
+pin_buffer (const void *buffer UNUSED, unsigned size UNUSED, bool write UNUSED)
+{
+#ifdef VM
+  pin_user_pages (buffer, size, write);
+#endif
+}
+
+static void
+unpin_buffer (const void *buffer UNUSED, unsigned size UNUSED)
+{
+#ifdef VM
+  unpin_user_pages (buffer, size);
+#endif
+}
+
+/* Returns how many of the SIZE bytes at BUFFER one pin_buffer()
+   may cover, cut to whole sectors so that an aligned direct
+   transfer stays aligned from one piece to the next. */
+static unsigned
+pin_chunk (const void *buffer UNUSED, unsigned size)
+{
+#ifdef VM
+  unsigned max = ROUND_DOWN (PIN_USER_MAX * PGSIZE - pg_ofs (buffer),
+                             BLOCK_SECTOR_SIZE);
+  if (size > max)
+    return max;
+#endif
+  return size;
+}
+
+/* Reads SIZE bytes of FILE into BUFFER, at OFFSET if AT, otherwise
+   at the file position, pinning a piece of BUFFER at a time.  Stops
+   at the first short read. */
+static off_t
+read_pinned (struct file *file, uint8_t *buffer, unsigned size,
+             bool at, off_t offset)
+{
+  off_t bytes_read = 0;
+
+  while (size > 0)
+    {
+      unsigned chunk = pin_chunk (buffer, size);
+      off_t n;
+
+      pin_buffer (buffer, chunk, true);
+      n = at ? file_read_at (file, buffer, chunk, offset + bytes_read)
+             : file_read (file, buffer, chunk);
+      unpin_buffer (buffer, chunk);
+
+      bytes_read += n;
+      if (n != (off_t) chunk)
+        break;
+      buffer += chunk;
+      size -= chunk;
+    }
+  return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER to FILE like read_pinned(). */
+static off_t
+write_pinned (struct file *file, const uint8_t *buffer, unsigned size,
+              bool at, off_t offset)
+{
+  off_t bytes_written = 0;
+
+  while (size > 0)
+    {
+      unsigned chunk = pin_chunk (buffer, size);
+      off_t n;
+
+      pin_buffer (buffer, chunk, false);
+      n = at ? file_write_at (file, buffer, chunk, offset + bytes_written)
+             : file_write (file, buffer, chunk);
+      unpin_buffer (buffer, chunk);
+
+      bytes_written += n;
+      if (n != (off_t) chunk)
+        break;
+      buffer += chunk;
+      size -= chunk;
+    }
+  return bytes_written;
+}
+
 /*modified: make system call function*/
 void 
 halt()
@@ -117,7 +227,7 @@ read (int fd, void* buffer, unsigned size)
     exit(-1);
   }
 
-  if(fdesc && fdesc->file) result = file_read(fdesc->file, buffer, size);
+  if(fdesc && fdesc->file) result = read_pinned(fdesc->file, buffer, size, false, 0);
   else{          
     lock_release(&file_lock);
     exit(-1);
@@ -146,7 +256,7 @@ write (int fd, const void *buffer, unsigned size)
 
   struct file_desc* fdesc = find_file_desc(thread_current(), fd, FD_FILE);
 
-  if(fdesc && fdesc->file) result = file_write(fdesc->file, buffer, size);
+  if(fdesc && fdesc->file) result = write_pinned(fdesc->file, buffer, size, false, 0);
   else{
     lock_release(&file_lock);
     exit(-1);
@@ -157,6 +267,392 @@ write (int fd, const void *buffer, unsigned size)
   return result;
 }
 
+/* Reads SIZE bytes at OFFSET without touching the file position.
+   Returns -1 if OFFSET does not fit in a file offset. */
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  int result;
+
+  check_vaddr(buffer + size - 1);
+  if(offset > INT_MAX)
+    return -1;
+
+  lock_acquire (&file_lock);
+
+  struct file_desc* fdesc = find_file_desc(thread_current(), fd, FD_FILE);
+  if(fdesc == NULL || fdesc->file == NULL) {
+    lock_release (&file_lock);
+    exit(-1);
+  }
+
+  result = read_pinned(fdesc->file, buffer, size, true, offset);
+
+  lock_release (&file_lock);
+
+  return result;
+}
+
+/* Writes SIZE bytes at OFFSET without touching the file position.
+   Returns -1 if OFFSET does not fit in a file offset. */
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  int result;
+
+  check_vaddr(buffer + size - 1);
+  if(offset > INT_MAX)
+    return -1;
+
+  lock_acquire (&file_lock);
+
+  struct file_desc* fdesc = find_file_desc(thread_current(), fd, FD_FILE);
+  if(fdesc == NULL || fdesc->file == NULL) {
+    lock_release (&file_lock);
+    exit(-1);
+  }
+
+  result = write_pinned(fdesc->file, buffer, size, true, offset);
+
+  lock_release (&file_lock);
+
+  return result;
+}
+
+/* Checks the IOVCNT entries of IOV and every buffer they point to. */
+static bool
+check_iovec (const struct iovec *iov, int iovcnt)
+{
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return false;
+  if (iovcnt == 0)
+    return true;
+
+  check_vaddr((const uint8_t *)(iov + iovcnt) - 1);
+  for (int i = 0; i < iovcnt; i++)
+    if (iov[i].iov_len > 0)
+      check_vaddr((const uint8_t *)iov[i].iov_base + iov[i].iov_len - 1);
+
+  return true;
+}
+
+/* Fills the IOVCNT buffers of IOV in order from the file position,
+   stopping at the first short read. */
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  int result = 0;
+
+  if (!check_iovec(iov, iovcnt))
+    return -1;
+
+  lock_acquire (&file_lock);
+
+  if(fd == 0) {
+    for(int i = 0; i < iovcnt; i++)
+      for(unsigned j = 0; j < iov[i].iov_len; j++, result++)
+        put_user((uint8_t *)iov[i].iov_base + j, input_getc());
+
+    lock_release (&file_lock);
+    return result;
+  }
+
+  struct file_desc* fdesc = find_file_desc(thread_current(), fd, FD_FILE);
+  if(fdesc == NULL || fdesc->file == NULL) {
+    lock_release (&file_lock);
+    exit(-1);
+  }
+
+  for(int i = 0; i < iovcnt; i++) {
+    off_t n = read_pinned(fdesc->file, iov[i].iov_base, iov[i].iov_len,
+                          false, 0);
+    result += n;
+    if(n != (off_t)iov[i].iov_len) break;
+  }
+
+  lock_release (&file_lock);
+
+  return result;
+}
+
+/* Writes the IOVCNT buffers of IOV in order at the file position,
+   stopping at the first short write. */
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  int result = 0;
+
+  if (!check_iovec(iov, iovcnt))
+    return -1;
+
+  lock_acquire (&file_lock);
+
+  if(fd == 1) {
+    for(int i = 0; i < iovcnt; i++) {
+      putbuf(iov[i].iov_base, iov[i].iov_len);
+      result += iov[i].iov_len;
+    }
+
+    lock_release (&file_lock);
+    return result;
+  }
+
+  struct file_desc* fdesc = find_file_desc(thread_current(), fd, FD_FILE);
+  if(fdesc == NULL || fdesc->file == NULL) {
+    lock_release (&file_lock);
+    exit(-1);
+  }
+
+  for(int i = 0; i < iovcnt; i++) {
+    off_t n = write_pinned(fdesc->file, iov[i].iov_base, iov[i].iov_len,
+                           false, 0);
+    result += n;
+    if(n != (off_t)iov[i].iov_len) break;
+  }
+
+  lock_release (&file_lock);
+
+  return result;
+}
+
+/* Copies SIZE bytes from FD_IN's position to FD_OUT's position
+   inside the file system, advancing both.  Fails if the two
+   descriptors share an inode and the destination range starts
+   inside the source range. */
+int
+copy_file_range (int fd_in, int fd_out, unsigned size)
+{
+  int result;
+
+  lock_acquire (&file_lock);
+
+  struct file_desc* in = find_file_desc(thread_current(), fd_in, FD_FILE);
+  struct file_desc* out = find_file_desc(thread_current(), fd_out, FD_FILE);
+  if(in == NULL || in->file == NULL || out == NULL || out->file == NULL) {
+    lock_release (&file_lock);
+    exit(-1);
+  }
+
+  off_t in_pos = file_tell(in->file), out_pos = file_tell(out->file);
+  if(file_get_inode(in->file) == file_get_inode(out->file)
+     && out_pos > in_pos && size > (unsigned)(out_pos - in_pos)) {
+    lock_release (&file_lock);
+    return -1;
+  }
+
+  result = file_copy(out->file, in->file, size);
+
+  lock_release (&file_lock);
+
+  return result;
+}
+
+/* Reserves disk space for SIZE bytes of FD's file from OFFSET on,
+   growing the file if needed.  The space reads as zeros. */
+bool
+fallocate (int fd, unsigned offset, unsigned size)
+{
+  bool result;
+
+  lock_acquire (&file_lock);
+
+  struct file_desc* fdesc = find_file_desc(thread_current(), fd, FD_FILE);
+  if(fdesc == NULL || fdesc->file == NULL) {
+    lock_release (&file_lock);
+    exit(-1);
+  }
+
+  result = file_allocate(fdesc->file, offset, size);
+
+  lock_release (&file_lock);
+
+  return result;
+}
+
+/* Sets the length of FD's file to LENGTH bytes.  Blocks cut off
+   the end are freed in the background. */
+bool
+ftruncate (int fd, unsigned length)
+{
+  bool result;
+
+  lock_acquire (&file_lock);
+
+  struct file_desc* fdesc = find_file_desc(thread_current(), fd, FD_FILE);
+  if(fdesc == NULL || fdesc->file == NULL) {
+    lock_release (&file_lock);
+    exit(-1);
+  }
+
+  result = file_truncate(fdesc->file, length);
+
+  lock_release (&file_lock);
+
+  return result;
+}
+
+/* Turns direct I/O on FD on or off.  Sector-aligned reads and
+   writes then bypass the buffer cache. */
+bool
+directio (int fd, bool on)
+{
+  lock_acquire (&file_lock);
+
+  struct file_desc* fdesc = find_file_desc(thread_current(), fd, FD_FILE);
+  if(fdesc == NULL || fdesc->file == NULL) {
+    lock_release (&file_lock);
+    exit(-1);
+  }
+
+  file_set_direct(fdesc->file, on);
+
+  lock_release (&file_lock);
+
+  return true;
+}
+
+/* Writes back only the cache slots that belong to FD's file. */
+int
+fsync (int fd)
+{
+  lock_acquire (&file_lock);
+
+  struct file_desc* fdesc = find_file_desc(thread_current(), fd, FD_FILE | FD_DIRECTORY);
+  if(fdesc == NULL) {
+    lock_release (&file_lock);
+    return -1;
+  }
+
+  file_sync(fdesc->file);
+
+  lock_release (&file_lock);
+
+  return 0;
+}
+
+void
+sync (void)
+{
+  lock_acquire (&file_lock);
+  filesys_sync();
+  lock_release (&file_lock);
+}
+
+/* Reports the timer, the file system disk's sector counters and
+   how much of the free map is in use. */
+void
+fsstat (struct fsstat *st)
+{
+  check_vaddr(st);
+  check_vaddr((const uint8_t *)(st + 1) - 1);
+
+  st->ticks = timer_ticks();
+  block_get_stats(block_get_role(BLOCK_FILESYS), &st->read_cnt, &st->write_cnt);
+
+  size_t used_cnt, reserved_cnt;
+  free_map_stat (&used_cnt, &reserved_cnt);
+  st->used_cnt = used_cnt;
+  st->reserved_cnt = reserved_cnt;
+}
+
+#ifdef VM
+/* Maps FD's file into memory at ADDR, one lazily loaded page at a
+   time.  The pages are the page cache's, so they stay coherent
+   with read() and write() on the same file. */
+mapid_t
+mmap (int fd, void *addr)
+{
+  struct thread *cur = thread_current();
+  struct mmap_file *mmap_file;
+  off_t length, ofs;
+
+  if(addr == NULL || pg_ofs(addr) != 0)
+    return MAP_FAILED;
+
+  lock_acquire (&file_lock);
+
+  struct file_desc* fdesc = find_file_desc(cur, fd, FD_FILE);
+  if(fdesc == NULL || fdesc->file == NULL
+     || (length = file_length(fdesc->file)) == 0) {
+    lock_release (&file_lock);
+    return MAP_FAILED;
+  }
+
+  /* Every page must be free user address space. */
+  for(ofs = 0; ofs < length; ofs += PGSIZE)
+    if(!is_user_vaddr(addr + ofs) || find_vme(addr + ofs) != NULL) {
+      lock_release (&file_lock);
+      return MAP_FAILED;
+    }
+
+  mmap_file = malloc(sizeof *mmap_file);
+  if(mmap_file == NULL) {
+    lock_release (&file_lock);
+    return MAP_FAILED;
+  }
+  mmap_file->mapid = cur->next_mapid++;
+  mmap_file->file = file_reopen(fdesc->file);
+  list_init(&mmap_file->vme_list);
+  list_push_back(&cur->mmap_list, &mmap_file->elem);
+
+  for(ofs = 0; ofs < length; ofs += PGSIZE) {
+    struct vm_entry *vme = malloc(sizeof *vme);
+    if(vme == NULL) {
+      do_munmap(mmap_file);
+      lock_release (&file_lock);
+      return MAP_FAILED;
+    }
+    vme->type = VM_FILE;
+    vme->vaddr = addr + ofs;
+    vme->writable = true;
+    vme->is_loaded = false;
+    vme->evicting = NULL;
+    vme->swapcache = NULL;
+    vme->swap_slot = BITMAP_ERROR;
+    vme->file = mmap_file->file;
+    vme->offset = ofs;
+    vme->read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+    vme->zero_bytes = PGSIZE - vme->read_bytes;
+    insert_vme(&cur->vm, vme);
+    list_push_back(&mmap_file->vme_list, &vme->mmap_elem);
+  }
+
+  lock_release (&file_lock);
+
+  return mmap_file->mapid;
+}
+
+/* Removes the mapping MAPID, leaving what was written to it in the
+   page cache. */
+void
+munmap (mapid_t mapid)
+{
+  struct list_elem *e;
+
+  lock_acquire (&file_lock);
+
+  for(e = list_begin(&thread_current()->mmap_list);
+      e != list_end(&thread_current()->mmap_list); e = list_next(e)) {
+    struct mmap_file *mmap_file = list_entry(e, struct mmap_file, elem);
+    if(mmap_file->mapid == mapid) {
+      do_munmap(mmap_file);
+      break;
+    }
+  }
+
+  lock_release (&file_lock);
+}
+
+/* Copies the process that made the system call in F.  The child
+   takes file_lock itself while it copies files, so that a child
+   that fails can still exit while this process waits for it. */
+pid_t
+do_fork (struct intr_frame *f)
+{
+  return process_fork(f);
+}
+#endif
+
 /*modified: make additional system call function*/
 int 
 fibonacci(int n)
@@ -431,6 +927,12 @@ find_file_desc(struct thread *t, int fd, int flag)
 static void
 syscall_handler (struct intr_frame *f UNUSED) 
 {
+#ifdef VM
+  /* Page faults on user memory inside the kernel need the user
+     stack pointer to tell stack growth from a bad access. */
+  thread_current()->esp = f->esp;
+#endif
+
   switch ((int)*(uint32_t *)(f->esp)) {
     case SYS_HALT:
 		  halt();
@@ -516,5 +1018,78 @@ syscall_handler (struct intr_frame *f UNUSED)
       check_vaddr(f->esp + 4);
       f->eax = inumber((int)*(uint32_t *)(f->esp + 4));
       break;                 
+    case SYS_PREAD:
+      check_vaddr(f->esp + 4); check_vaddr(f->esp + 8);
+      check_vaddr(f->esp + 12); check_vaddr(f->esp + 16);
+      f->eax = pread((int)*(uint32_t *)(f->esp + 4), (void *)*(uint32_t *)(f->esp + 8),
+            (unsigned)*(uint32_t *)(f->esp + 12), (unsigned)*(uint32_t *)(f->esp + 16));
+      break;
+    case SYS_PWRITE:
+      check_vaddr(f->esp + 4); check_vaddr(f->esp + 8);
+      check_vaddr(f->esp + 12); check_vaddr(f->esp + 16);
+      f->eax = pwrite((int)*(uint32_t *)(f->esp + 4), (const void *)*(uint32_t *)(f->esp + 8),
+            (unsigned)*(uint32_t *)(f->esp + 12), (unsigned)*(uint32_t *)(f->esp + 16));
+      break;
+    case SYS_READV:
+      check_vaddr(f->esp + 4); check_vaddr(f->esp + 8); check_vaddr(f->esp + 12);
+      f->eax = readv((int)*(uint32_t *)(f->esp + 4), (const struct iovec *)*(uint32_t *)(f->esp + 8),
+            (int)*(uint32_t *)(f->esp + 12));
+      break;
+    case SYS_WRITEV:
+      check_vaddr(f->esp + 4); check_vaddr(f->esp + 8); check_vaddr(f->esp + 12);
+      f->eax = writev((int)*(uint32_t *)(f->esp + 4), (const struct iovec *)*(uint32_t *)(f->esp + 8),
+            (int)*(uint32_t *)(f->esp + 12));
+      break;
+    case SYS_COPY_FILE_RANGE:
+      check_vaddr(f->esp + 4); check_vaddr(f->esp + 8); check_vaddr(f->esp + 12);
+      f->eax = copy_file_range((int)*(uint32_t *)(f->esp + 4), (int)*(uint32_t *)(f->esp + 8),
+            (unsigned)*(uint32_t *)(f->esp + 12));
+      break;
+    case SYS_FALLOCATE:
+      check_vaddr(f->esp + 4); check_vaddr(f->esp + 8); check_vaddr(f->esp + 12);
+      f->eax = fallocate((int)*(uint32_t *)(f->esp + 4), (unsigned)*(uint32_t *)(f->esp + 8),
+            (unsigned)*(uint32_t *)(f->esp + 12));
+      break;
+    case SYS_FTRUNCATE:
+      check_vaddr(f->esp + 4); check_vaddr(f->esp + 8);
+      f->eax = ftruncate((int)*(uint32_t *)(f->esp + 4), (unsigned)*(uint32_t *)(f->esp + 8));
+      break;
+    case SYS_DIRECTIO:
+      check_vaddr(f->esp + 4); check_vaddr(f->esp + 8);
+      f->eax = directio((int)*(uint32_t *)(f->esp + 4), (bool)*(uint32_t *)(f->esp + 8));
+      break;
+    case SYS_FSYNC:
+      check_vaddr(f->esp + 4);
+      f->eax = fsync((int)*(uint32_t *)(f->esp + 4));
+      break;
+    case SYS_SYNC:
+      sync();
+      break;
+#ifdef VM
+    case SYS_MMAP:
+      check_vaddr(f->esp + 4); check_vaddr(f->esp + 8);
+      f->eax = mmap((int)*(uint32_t *)(f->esp + 4), (void *)*(uint32_t *)(f->esp + 8));
+      break;
+    case SYS_MUNMAP:
+      check_vaddr(f->esp + 4);
+      munmap((mapid_t)*(uint32_t *)(f->esp + 4));
+      break;
+    case SYS_FORK:
+      f->eax = do_fork(f);
+      break;
+#endif
+    case SYS_FSSTAT:
+      check_vaddr(f->esp + 4);
+      fsstat((struct fsstat *)*(uint32_t *)(f->esp + 4));
+      break;
+  }
+
+  /* On the way out, where no file system lock is held, give delayed
+     blocks their sectors if they crowd the buffer cache or have
+     waited too long. */
+  if (inode_writeback_due ()) {
+    lock_acquire (&file_lock);
+    inode_commit_all ();
+    lock_release (&file_lock);
   }
 }
\ No newline at end of file
@@ -19,16 +19,6 @@ struct file_desc {
   struct dir* dir;
 };
 
-/* modified5 : referenced from pintos doc */
-static bool 
-put_user (uint8_t *udst, uint8_t byte)
-{
-  int error_code;
-  asm ("movl $1f, %0; movb %b2, %1; 1:"
-       : "=&a" (error_code), "=m" (*udst) : "q" (byte));
-  return error_code != -1;
-}
-
 void syscall_init (void);
 /*modified: system call function*/
 void check_vaddr(const void *vaddr);
@@ -52,10 +42,35 @@ bool mkdir(const char *dir);
 bool readdir(int fd, char *name);
 bool isdir(int fd);
 int inumer(int fd);
+/* positional and vectored I/O */
+int pread (int fd, void *buffer, unsigned size, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned size, unsigned offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int fd_in, int fd_out, unsigned size);
+bool fallocate (int fd, unsigned offset, unsigned size);
+bool ftruncate (int fd, unsigned length);
+bool directio (int fd, bool on);
+/* durability */
+int fsync (int fd);
+void sync (void);
+/* benchmarking */
+void fsstat (struct fsstat *st);
+#ifdef VM
+/* memory mapped files */
+mapid_t mmap (int fd, void *addr);
+void munmap (mapid_t mapid);
+/* process cloning */
+struct intr_frame;
+pid_t do_fork (struct intr_frame *f);
+#endif
 /*modified: additional system call function*/
 int fibonacci(int n);
 int max_of_four_int(int a, int b, int c, int d);
 /*modfied4 : file system */
 struct file_desc* find_file_desc(struct thread *t, int fd, int flag);
 
+/* Serializes the file system. */
+extern struct lock file_lock;
+
 #endif /* userprog/syscall.h */
@@ -1,27 +1,133 @@
 #include "vm/frame.h"
 #include "vm/swap.h"
+#include "vm/page_cache.h"
 #include "threads/thread.h"
 #include "threads/synch.h"
 #include "userprog/pagedir.h"
 #include "filesys/file.h"
-#include <threads/malloc.h>
+#include "threads/vaddr.h"
+#include "lib/kernel/bitmap.h"
+#include <round.h>
+#include <string.h>
 #include <stdio.h>
 
+/* one struct page per user pool frame, indexed by its place in the
+   pool. an entry is in use while its kaddr is not NULL */
+static struct page *frame_table;
+static size_t frame_cnt;
+
+/* kswapd starts evicting once fewer than LOW_WATERMARK user frames
+   are free and stops at HIGH_WATERMARK, so that page faults rarely
+   have to evict for themselves */
+static size_t low_watermark, high_watermark;
+static struct semaphore kswapd_sema;
+static bool kswapd_awake;
+
+/* frames on the lru lists, each list oldest first */
+static struct list lru_lists[LRU_CNT];
+static size_t lru_cnt[LRU_CNT];
+
+/* read-only pages of executables, keyed by where in which file they
+   were read from, so that every process running a program maps the
+   same frame */
+static struct hash text_pages;
+
+static thread_func kswapd NO_RETURN;
+static unsigned text_hash_func(const struct hash_elem *e, void *aux);
+static bool text_less_func(const struct hash_elem *a,
+		const struct hash_elem *b, void *aux);
+static void forget_text_page(struct page *page);
+static struct vm_entry *page_vme(struct page *page);
+static bool page_is_file(struct page *page);
+static bool page_pinned(struct page *page);
+static bool page_referenced(struct page *page);
+static void lru_move(struct page *page, int type);
+static void keep_page(struct page *page);
+static void shrink_active_list(bool file);
+static struct page *shrink_inactive_list(bool file);
+
 /* initialize */
 void 
 lru_list_init(void){
-	list_init(&lru_list);
+	int type;
+
+	for(type = 0; type < LRU_CNT; type++){
+		list_init(&lru_lists[type]);
+		lru_cnt[type] = 0;
+	}
 	lock_init(&lru_list_lock);
-	lru_clock = NULL;
+	hash_init(&text_pages, text_hash_func, text_less_func, NULL);
+
+	/* sized once for the whole user pool, from the kernel pool */
+	frame_cnt = palloc_user_pages();
+	frame_table = palloc_get_multiple(PAL_ASSERT | PAL_ZERO,
+			DIV_ROUND_UP(frame_cnt * sizeof *frame_table, PGSIZE));
+	for(size_t i = 0; i < frame_cnt; i++){
+		list_init(&frame_table[i].vmes);
+		cond_init(&frame_table[i].evicted);
+	}
+
+	/* watermarks scale with the pool, but a tiny pool still keeps a few */
+	low_watermark = frame_cnt / FRAME_LOW_RATIO;
+	if(low_watermark < FRAME_LOW_MIN)
+		low_watermark = FRAME_LOW_MIN;
+	high_watermark = low_watermark * 2;
+
+	sema_init(&kswapd_sema, 0);
+	kswapd_awake = false;
+	thread_create("kswapd", PRI_DEFAULT, kswapd, NULL);
 }
 
-/* add page to lru list */
+/* background reclaimer. sleeps until free frames drop below the low
+   watermark, then frees frames until they are back at the high one.
+   caches that grew into spare memory give it back first, and only
+   then are process pages evicted */
+static void
+kswapd(void *aux UNUSED)
+{
+	for(;;){
+		size_t free_cnt;
+
+		sema_down(&kswapd_sema);
+		while((free_cnt = palloc_user_free()) < high_watermark){
+			if(palloc_shrink(true, high_watermark - free_cnt) > 0)
+				continue;
+			if(!try_to_free_pages())
+				break;
+		}
+		kswapd_awake = false;
+	}
+}
+
+/* free user frames below which kswapd reclaims. a cache growing into
+   spare memory should stop here, or kswapd evicts process pages to
+   make room for it */
+size_t
+frame_high_watermark(void)
+{
+	return high_watermark;
+}
+
+/* get the frame table entry of user frame KADDR */
+struct page *
+kaddr_to_page(void *kaddr)
+{
+	size_t idx = palloc_user_index(kaddr);
+
+	ASSERT(idx < frame_cnt);
+	return &frame_table[idx];
+}
+
+/* add page to lru list. a new page starts out inactive, and on the
+   file side: the first scan moves it over if it turns out anonymous */
 void 
 add_page_to_lru_list(struct page *page)
 {
 	if(page != NULL){
      	lock_acquire(&lru_list_lock);
-		list_push_back(&lru_list, &page->lru);
+		page->lru_type = LRU_INACTIVE_FILE;
+		list_push_back(&lru_lists[page->lru_type], &page->lru);
+		lru_cnt[page->lru_type]++;
 		lock_release(&lru_list_lock);
 	}
 }
@@ -31,11 +137,8 @@ void
 del_page_from_lru_list(struct page* page)
 {
 	if(page != NULL){
-		/* save as lru_clock */
-		if(lru_clock == page)
-			lru_clock = list_entry(list_remove(&page->lru), struct page, lru);
-		else
-			list_remove(&page->lru);
+		list_remove(&page->lru);
+		lru_cnt[page->lru_type]--;
 	}
 }
 
@@ -50,47 +153,47 @@ alloc_page(enum palloc_flags flags)
 	/* allocate physical memory */
 	kaddr = palloc_get_page(flags);
 
-	/* if fail, free physical memory and retry physical memory allocate*/
+	/* if fail, free physical memory and retry physical memory
+	   allocate, until nothing more can be freed */
 	while(kaddr == NULL){
-		try_to_free_pages();
+		if(!try_to_free_pages())
+			return NULL;
 		kaddr = palloc_get_page(flags);
 	}
 	
-	/*allocate new page*/
-	new_page = malloc(sizeof(struct page));
-	if(new_page == NULL){
-		palloc_free_page(kaddr);
-		return NULL;
-	}
+	/* the frame's own entry in the frame table */
+	new_page = kaddr_to_page(kaddr);
 
-	/* initialize page */
+	/* initialize page. it is pinned for the caller, who unpins it
+	   once it is mapped */
 	new_page->kaddr  = kaddr;
-	new_page->pg_thread = thread_current();
+	list_init(&new_page->vmes);
+	new_page->pin_cnt = 1;
+	new_page->text_inode = NULL;
 	
 	/* insert page to lru list */
 	add_page_to_lru_list(new_page);
 
+	/* start evicting ahead of demand once free frames run low */
+	if(!kswapd_awake && palloc_user_free() < low_watermark){
+		kswapd_awake = true;
+		sema_up(&kswapd_sema);
+	}
+
 	return new_page;
 }
 
 void 
 free_page(void *kaddr)
 {
-	struct list_elem *element;
-	struct page *lru_page;
+	struct page *page = kaddr_to_page(kaddr);
 
 	/* get lock */
 	lock_acquire(&lru_list_lock);
 
-	/* find page */
-	for(element = list_begin(&lru_list); element != list_end(&lru_list); element = list_next(element)){
-		lru_page = list_entry(element, struct page, lru);
-		/* if find page, call the __free_page */
-		if(lru_page->kaddr == kaddr){
-			__free_page(lru_page);
-			break;
-		}
-	}
+	/* frames of the page cache have no entry in use */
+	if(page->kaddr == kaddr)
+		__free_page(page);
 	
 	lock_release(&lru_list_lock);
 }
@@ -102,87 +205,649 @@ __free_page(struct page *page)
 	palloc_free_page(page->kaddr);
 	/* delete page from lru_list */
 	del_page_from_lru_list(page);
-	/* free page */
-	free(page);
+	forget_text_page(page);
+	/* the entry is free again */
+	list_init(&page->vmes);
+	page->kaddr = NULL;
 }
 
-struct list_elem* 
-get_next_lru_clock(void)
+/* map PAGE, a new frame the caller still has pinned, for VME */
+void
+page_add_vme(struct page *page, struct vm_entry *vme)
 {
-	struct list_elem *element;
+	lock_acquire(&lru_list_lock);
+	list_push_back(&page->vmes, &vme->page_elem);
+	lock_release(&lru_list_lock);
+}
+
+/* unmap the page VME describes, waiting out its eviction, and free
+   its frame unless a forked process still shares it. returns
+   whether the page was in memory */
+bool
+put_page(struct vm_entry *vme)
+{
+	uint32_t *pd = vme->thread->pagedir;
+	bool loaded;
+
+	lock_acquire(&lru_list_lock);
+	while(vme->evicting != NULL)
+		cond_wait(&vme->evicting->evicted, &lru_list_lock);
+	loaded = vme->is_loaded;
+	if(loaded){
+		void *kaddr = pagedir_get_page(pd, vme->vaddr);
+		struct page *page = kaddr_to_page(kaddr);
 
-	/* if lru_clock is NULL */
-	if(lru_clock == NULL){
-		/* return first element of lru_list */
-		element = list_begin(&lru_list);
-		lru_clock = list_entry(element, struct page, lru);
-		
-		return element;
+		pagedir_clear_page(pd, vme->vaddr);
+		vme->is_loaded = false;
+		if(page->kaddr == kaddr){
+			list_remove(&vme->page_elem);
+			if(list_empty(&page->vmes))
+				__free_page(page);
+		}
 	}
+	lock_release(&lru_list_lock);
+	return loaded;
+}
 
-	element = list_next(&lru_clock->lru);
-	/* if lru_clock page is final page of lru_list */
-	if(element == list_end(&lru_list)){
-		/* if lru_list has only one page */
-		if(&lru_clock->lru == list_begin(&lru_list))
-			return NULL;
-		/* lru_list has more than one page, lru_clock points list begin page */
-		else 
-			element = list_begin(&lru_list);
-		
+/* undo page_add_vme(PAGE, VME) for a page that could not be mapped,
+   and unpin it. the frame is freed unless another process maps it */
+void
+drop_page(struct page *page, struct vm_entry *vme)
+{
+	lock_acquire(&lru_list_lock);
+	list_remove(&vme->page_elem);
+	page->pin_cnt--;
+	if(list_empty(&page->vmes))
+		__free_page(page);
+	lock_release(&lru_list_lock);
+}
+
+static unsigned
+text_hash_func(const struct hash_elem *e, void *aux UNUSED)
+{
+	struct page *page = hash_entry(e, struct page, text_elem);
+
+	return hash_bytes(&page->text_inode, sizeof page->text_inode)
+		^ hash_int(page->text_offset);
+}
+
+static bool
+text_less_func(const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED)
+{
+	struct page *page_a = hash_entry(a, struct page, text_elem);
+	struct page *page_b = hash_entry(b, struct page, text_elem);
+
+	if(page_a->text_inode != page_b->text_inode)
+		return page_a->text_inode < page_b->text_inode;
+	if(page_a->text_offset != page_b->text_offset)
+		return page_a->text_offset < page_b->text_offset;
+	return page_a->text_bytes < page_b->text_bytes;
+}
+
+/* find the frame another process running the same executable has
+   read VME's read-only page into, and map it for VME too, pinned
+   for the caller to install. returns NULL if there is none */
+struct page *
+find_text_page(struct vm_entry *vme)
+{
+	struct page key, *page = NULL;
+	struct hash_elem *element;
+
+	key.text_inode = file_get_inode(vme->file);
+	key.text_offset = vme->offset;
+	key.text_bytes = vme->read_bytes;
+
+	lock_acquire(&lru_list_lock);
+	element = hash_find(&text_pages, &key.text_elem);
+	if(element != NULL){
+		page = hash_entry(element, struct page, text_elem);
+		list_push_back(&page->vmes, &vme->page_elem);
+		page->pin_cnt++;
 	}
-	lru_clock = list_entry(element, struct page, lru);
+	lock_release(&lru_list_lock);
+	return page;
+}
 
-	return element;
+/* offer PAGE, which VME's read-only page of an executable was just
+   read into, to the next process that faults on the same page */
+void
+add_text_page(struct page *page, struct vm_entry *vme)
+{
+	lock_acquire(&lru_list_lock);
+	page->text_inode = file_get_inode(vme->file);
+	page->text_offset = vme->offset;
+	page->text_bytes = vme->read_bytes;
+	if(hash_insert(&text_pages, &page->text_elem) != NULL)
+		page->text_inode = NULL;
+	lock_release(&lru_list_lock);
 }
 
-void 
-try_to_free_pages(void)
+/* stop offering PAGE to processes running its executable */
+static void
+forget_text_page(struct page *page)
 {
-	struct thread *page_thread;
-	struct list_elem *element;
-	struct page *lru_page;
+	if(page->text_inode != NULL){
+		hash_delete(&text_pages, &page->text_elem);
+		page->text_inode = NULL;
+	}
+}
+
+/* set up COPY, fork()'s copy of PARENT_VME for the current process,
+   to hold the same page. a page in memory is mapped read-only into
+   both processes, for the first to write to copy; a page in swap
+   shares its slot. returns false if memory is short */
+bool
+fork_page(struct vm_entry *parent_vme, struct vm_entry *copy)
+{
+	uint32_t *parent_pd = parent_vme->thread->pagedir;
+	uint32_t *pd = copy->thread->pagedir;
+	bool success = true;
+
+	copy->is_loaded = false;
+	copy->evicting = NULL;
+	copy->swapcache = NULL;
+	copy->swap_slot = BITMAP_ERROR;
 
 	lock_acquire(&lru_list_lock);
+	while(parent_vme->evicting != NULL)
+		cond_wait(&parent_vme->evicting->evicted, &lru_list_lock);
+	if(parent_vme->is_loaded){
+		void *kaddr = pagedir_get_page(parent_pd, parent_vme->vaddr);
 
-	/* if list is empty */
-	if(list_empty(&lru_list) == true){
+		success = pagedir_set_page(pd, copy->vaddr, kaddr, false);
+		if(success){
+			list_push_back(&kaddr_to_page(kaddr)->vmes, &copy->page_elem);
+			pagedir_set_writable(parent_pd, parent_vme->vaddr, false);
+			/* a copy that differs from the executable must not be
+			   dropped as clean by whichever process keeps it */
+			if(pagedir_is_dirty(parent_pd, parent_vme->vaddr))
+				pagedir_set_dirty(pd, copy->vaddr, true);
+			copy->is_loaded = true;
+		}
+	}
+	else if(parent_vme->type == VM_ANON && parent_vme->swap_slot != BITMAP_ERROR){
+		swap_dup(parent_vme->swap_slot);
+		copy->swap_slot = parent_vme->swap_slot;
+	}
+	lock_release(&lru_list_lock);
+	return success;
+}
+
+/* give VME, which the current process just wrote to while it shares
+   its frame since fork(), a frame of its own. the last process left
+   on the frame keeps it and may write to it again. returns false if
+   the fault was not a write to such a page, or memory is short */
+bool
+unshare_page(struct vm_entry *vme)
+{
+	uint32_t *pd = vme->thread->pagedir;
+	struct page *page, *copy;
+	void *kaddr;
+
+	lock_acquire(&lru_list_lock);
+	kaddr = pagedir_get_page(pd, vme->vaddr);
+	if(kaddr == NULL){
+		/* evicted meanwhile: the retried write faults it back in */
 		lock_release(&lru_list_lock);
-		return;
+		return true;
+	}
+	page = kaddr_to_page(kaddr);
+	if(page->kaddr != kaddr){
+		lock_release(&lru_list_lock);
+		return false;
+	}
+	if(list_size(&page->vmes) == 1){
+		pagedir_set_writable(pd, vme->vaddr, true);
+		lock_release(&lru_list_lock);
+		return true;
+	}
+	page->pin_cnt++;
+	lock_release(&lru_list_lock);
+
+	copy = alloc_page(PAL_USER);
+	if(copy == NULL){
+		unpin_page(page);
+		return false;
+	}
+	memcpy(copy->kaddr, page->kaddr, PGSIZE);
+
+	lock_acquire(&lru_list_lock);
+	page->pin_cnt--;
+	/* every other sharer may have exited while the lock was dropped */
+	if(list_size(&page->vmes) == 1){
+		pagedir_set_writable(pd, vme->vaddr, true);
+		__free_page(copy);
+		lock_release(&lru_list_lock);
+		return true;
+	}
+	list_remove(&vme->page_elem);
+	if(list_empty(&page->vmes))
+		__free_page(page);
+	list_push_back(&copy->vmes, &vme->page_elem);
+	pagedir_clear_page(pd, vme->vaddr);
+	pagedir_set_page(pd, vme->vaddr, copy->kaddr, true);
+	copy->pin_cnt--;
+	lock_release(&lru_list_lock);
+	return true;
+}
+
+/* evict up to SWAP_CLUSTER user frames. clean pages of executables
+   and untouched pages of the swap cache go first, since dropping
+   them costs nothing; anonymous and dirty pages are written to swap
+   only when no clean page is cold, and then together, into adjacent
+   swap slots. a dirty page that finds swap full is mapped back in
+   and stays. returns false if no frame was freed.
+
+   the lists are locked only to pick the victims and to free them.
+   the swap write in between runs unlocked, with the victims off the
+   lists so that no one else can pick them, and an owner waits on
+   its victim alone if it faults on the page meanwhile */
+bool 
+try_to_free_pages(void)
+{
+	struct page *victims[SWAP_CLUSTER];
+	void *dirty_kaddrs[SWAP_CLUSTER];
+	size_t slots[SWAP_CLUSTER];
+	struct page *dirty_pages[SWAP_CLUSTER];
+	size_t cnt = 0, dirty_cnt = 0, dropped = 0, kept = 0, i;
+	struct list_elem *e;
+	int pass;
+
+	lock_acquire(&lru_list_lock);
+
+	/* the first pass clears the accessed bits it sees, so the second
+	   finds a victim unless every page is still being loaded */
+	for(pass = 0; pass < 2 && cnt + dropped == 0; pass++){
+		while(cnt + dropped < SWAP_CLUSTER){
+			struct page *victim = shrink_inactive_list(true);
+			struct vm_entry *vme;
+			bool dirty = false;
+
+			if(victim == NULL)
+				victim = shrink_inactive_list(false);
+			if(victim == NULL)
+				break;
+
+			/* read ahead but never touched: its slot still holds it */
+			vme = page_vme(victim);
+			del_page_from_lru_list(victim);
+			forget_text_page(victim);
+			if(vme->swapcache == victim){
+				vme->swapcache = NULL;
+				palloc_free_page(victim->kaddr);
+				victim->kaddr = NULL;
+				dropped++;
+				continue;
+			}
+
+			/* unmap from every process first, so the dirty bit cannot
+			   change after it is read */
+			for(e = list_begin(&victim->vmes); e != list_end(&victim->vmes);
+					e = list_next(e)){
+				vme = list_entry(e, struct vm_entry, page_elem);
+				pagedir_clear_page(vme->thread->pagedir, vme->vaddr);
+				if(pagedir_is_dirty(vme->thread->pagedir, vme->vaddr)
+						|| vme->type == VM_ANON)
+					dirty = true;
+				vme->is_loaded = false;
+				vme->evicting = victim;
+			}
+			if(dirty){
+				dirty_kaddrs[dirty_cnt] = victim->kaddr;
+				dirty_pages[dirty_cnt++] = victim;
+			}
+			victim->pin_cnt++;
+			victims[cnt++] = victim;
+		}
 	}
+	lock_release(&lru_list_lock);
+	if(cnt + dropped == 0)
+		return false;
+
+	/* dirty pages go to swap. processes that shared a page share
+	   its slot */
+	swap_out_cluster(dirty_kaddrs, dirty_cnt, slots);
+
+	lock_acquire(&lru_list_lock);
+	for(i = 0; i < dirty_cnt; i++){
+		if(slots[i] == BITMAP_ERROR){
+			keep_page(dirty_pages[i]);
+			kept++;
+			continue;
+		}
+		for(e = list_begin(&dirty_pages[i]->vmes); e != list_end(&dirty_pages[i]->vmes);
+				e = list_next(e)){
+			struct vm_entry *vme = list_entry(e, struct vm_entry, page_elem);
 
-	while(1){
-		/* get next element */
-		element = get_next_lru_clock();
-		/* if next element is NULL */
-		if(element == NULL){
+			vme->swap_slot = slots[i];
+			vme->type = VM_ANON;
+			if(e != list_begin(&dirty_pages[i]->vmes))
+				swap_dup(slots[i]);
+		}
+	}
+	for(i = 0; i < cnt; i++){
+		for(e = list_begin(&victims[i]->vmes); e != list_end(&victims[i]->vmes);
+				e = list_next(e))
+			list_entry(e, struct vm_entry, page_elem)->evicting = NULL;
+		cond_broadcast(&victims[i]->evicted, &lru_list_lock);
+		if(page_vme(victims[i])->is_loaded){
+			/* kept, for want of a swap slot */
+			victims[i]->pin_cnt--;
+			continue;
+		}
+		palloc_free_page(victims[i]->kaddr);
+		list_init(&victims[i]->vmes);
+		victims[i]->kaddr = NULL;
+	}
+	lock_release(&lru_list_lock);
+
+	return cnt + dropped > kept;
+}
+
+/* put back PAGE, a dirty victim of try_to_free_pages() that found
+   no swap slot, as it was before it was unmapped */
+static void
+keep_page(struct page *page)
+{
+	bool shared = list_size(&page->vmes) > 1;
+	struct list_elem *e;
+
+	for(e = list_begin(&page->vmes); e != list_end(&page->vmes); e = list_next(e)){
+		struct vm_entry *vme = list_entry(e, struct vm_entry, page_elem);
+		uint32_t *pd = vme->thread->pagedir;
+
+		/* pages shared since fork() stay read-only until written */
+		pagedir_set_page(pd, vme->vaddr, page->kaddr, vme->writable && !shared);
+		pagedir_set_dirty(pd, vme->vaddr, true);
+		vme->is_loaded = true;
+	}
+	page->lru_type = LRU_ACTIVE_ANON;
+	list_push_back(&lru_lists[page->lru_type], &page->lru);
+	lru_cnt[page->lru_type]++;
+}
+
+/* keep PAGE from being evicted until unpin_page() */
+void
+pin_page(struct page *page)
+{
+	lock_acquire(&lru_list_lock);
+	page->pin_cnt++;
+	lock_release(&lru_list_lock);
+}
+
+void
+unpin_page(struct page *page)
+{
+	lock_acquire(&lru_list_lock);
+	ASSERT(page->pin_cnt > 0);
+	page->pin_cnt--;
+	lock_release(&lru_list_lock);
+}
+
+/* fault in the current process's pages under the SIZE bytes at
+   UADDR and pin them, so that a syscall can copy to or from them
+   while it holds file_lock without them being evicted midway. for
+   a syscall that will WRITE to them, a page still shared since
+   fork() is copied now, since a pinned frame cannot be replaced.
+   the buffer may span at most PIN_USER_MAX pages. a fault while
+   the file system copies would have to reenter it, so every page
+   must be in memory before the copy starts. mapped file pages are
+   pinned in the page cache, which owns their frames. the thread
+   records how much of the buffer is pinned, so that a process
+   killed by a fault on a later page gives the earlier ones back */
+void
+pin_user_pages(const void *uaddr, size_t size, bool write)
+{
+	struct thread *cur = thread_current();
+	uint32_t *pd = cur->pagedir;
+	const uint8_t *start = uaddr;
+	const uint8_t *upage;
+
+	if(size == 0)
+		return;
+	ASSERT(pg_no(start + size - 1) - pg_no(start) < PIN_USER_MAX);
+	ASSERT(cur->pin_size == 0);
+	cur->pin_start = start;
+	for(upage = pg_round_down(start); upage < start + size; upage += PGSIZE){
+		/* the first page is touched at UADDR itself, which may be
+		   the only part of it the stack may grow to */
+		volatile uint8_t *touch = (uint8_t *)(upage < start ? start : upage);
+
+		for(;;){
+			struct vm_entry *vme;
+			void *kaddr;
+
+			if(write)
+				*touch = *touch;
+			else
+				(void) *touch;
+			vme = find_vme((void *)upage);
+			if(vme != NULL && vme->type == VM_FILE){
+				if(pcache_pin(vme))
+					break;
+				continue;
+			}
+			lock_acquire(&lru_list_lock);
+			kaddr = pagedir_get_page(pd, upage);
+			if(kaddr != NULL){
+				struct page *page = kaddr_to_page(kaddr);
+				if(page->kaddr == kaddr)
+					page->pin_cnt++;
+				lock_release(&lru_list_lock);
+				break;
+			}
+			/* evicted again before it could be pinned */
 			lock_release(&lru_list_lock);
-			return;
 		}
+		cur->pin_size = upage + PGSIZE < start + size
+			? (size_t)(upage + PGSIZE - start) : size;
+	}
+}
+
+/* undo pin_user_pages(UADDR, SIZE) */
+void
+unpin_user_pages(const void *uaddr, size_t size)
+{
+	struct thread *cur = thread_current();
+	uint32_t *pd = cur->pagedir;
+	const uint8_t *start = uaddr;
+	const uint8_t *upage;
 
-		lru_page = list_entry(element, struct page, lru);
+	if(size == 0)
+		return;
+	cur->pin_size = 0;
+	for(upage = pg_round_down(start); upage < start + size; upage += PGSIZE){
+		struct vm_entry *vme = find_vme((void *)upage);
+		void *kaddr;
+		struct page *page;
 
-		page_thread = lru_page->pg_thread;
-		/* if page address is accessed */
-		if(pagedir_is_accessed(page_thread->pagedir, lru_page->vme->vaddr)){
-			/* set accessed bit 0 and continue(it's not victim) */
-			pagedir_set_accessed(page_thread->pagedir, lru_page->vme->vaddr, false);
+		if(vme != NULL && vme->type == VM_FILE){
+			pcache_unpin(vme);
 			continue;
 		}
+		lock_acquire(&lru_list_lock);
+		kaddr = pagedir_get_page(pd, upage);
+		ASSERT(kaddr != NULL);
+		page = kaddr_to_page(kaddr);
+		if(page->kaddr == kaddr){
+			ASSERT(page->pin_cnt > 0);
+			page->pin_cnt--;
+		}
+		lock_release(&lru_list_lock);
+	}
+}
+
+/* wait until the page VME describes is out of memory, if it is
+   being evicted */
+void
+wait_on_page_eviction(struct vm_entry *vme)
+{
+	lock_acquire(&lru_list_lock);
+	while(vme->evicting != NULL)
+		cond_wait(&vme->evicting->evicted, &lru_list_lock);
+	lock_release(&lru_list_lock);
+}
 
-		/* if not accessed, it's victim */
-		/* if page is dirty */
-		if(pagedir_is_dirty(page_thread->pagedir, lru_page->vme->vaddr) || lru_page->vme->type == VM_ANON){	
-			lru_page->vme->type = VM_ANON;
-			lru_page->vme->swap_slot = swap_out(lru_page->kaddr);
+/* take the page read ahead for VME out of the swap cache, pinned
+   for the caller to map. returns NULL if there is none */
+struct page *
+swapcache_take(struct vm_entry *vme)
+{
+	struct page *page;
+
+	lock_acquire(&lru_list_lock);
+	page = vme->swapcache;
+	if(page != NULL){
+		vme->swapcache = NULL;
+		page->pin_cnt++;
+	}
+	lock_release(&lru_list_lock);
+	return page;
+}
+
+/* after a swap in fault on VME, read the swapped out pages of the
+   next SWAP_READAHEAD virtual pages of the current process into the
+   swap cache, where a fault finds them without another disk read.
+   they keep their slots until then, so an untouched one is dropped
+   for free. stops at the first page that is not in swap, and while
+   free frames are short, so it never evicts to read ahead */
+void
+swap_readahead(struct vm_entry *vme)
+{
+	for(int i = 1; i <= SWAP_READAHEAD; i++){
+		struct vm_entry *next = find_vme((uint8_t *)vme->vaddr + i * PGSIZE);
+		struct page *page;
+		bool swapped;
+
+		if(next == NULL || palloc_user_free() <= low_watermark)
+			break;
+		lock_acquire(&lru_list_lock);
+		swapped = next->type == VM_ANON && !next->is_loaded
+			&& next->evicting == NULL && next->swapcache == NULL
+			&& next->swap_slot != BITMAP_ERROR;
+		lock_release(&lru_list_lock);
+		if(!swapped)
+			break;
+
+		/* only this process brings NEXT back in, so it stays out */
+		page = alloc_page(PAL_USER);
+		if(page == NULL)
+			break;
+		swap_read(next->swap_slot, page->kaddr);
+
+		lock_acquire(&lru_list_lock);
+		list_push_back(&page->vmes, &next->page_elem);
+		next->swapcache = page;
+		page->pin_cnt--;
+		lock_release(&lru_list_lock);
+	}
+}
+
+/* the first of the vm_entries PAGE is mapped for */
+static struct vm_entry *
+page_vme(struct page *page)
+{
+	return list_entry(list_front(&page->vmes), struct vm_entry, page_elem);
+}
+
+/* whether PAGE can be dropped without writing it anywhere */
+static bool
+page_is_file(struct page *page)
+{
+	struct list_elem *e;
+
+	for(e = list_begin(&page->vmes); e != list_end(&page->vmes); e = list_next(e)){
+		struct vm_entry *vme = list_entry(e, struct vm_entry, page_elem);
+
+		if(vme->type != VM_BIN || pagedir_is_dirty(vme->thread->pagedir, vme->vaddr))
+			return false;
+	}
+	return true;
+}
+
+/* whether PAGE is pinned. a new page stays pinned until its owner
+   has filled and mapped it */
+static bool
+page_pinned(struct page *page)
+{
+	return page->pin_cnt > 0;
+}
+
+/* test and clear PAGE's accessed bit in every process mapping it */
+static bool
+page_referenced(struct page *page)
+{
+	struct list_elem *e;
+	bool referenced = false;
+
+	for(e = list_begin(&page->vmes); e != list_end(&page->vmes); e = list_next(e)){
+		struct vm_entry *vme = list_entry(e, struct vm_entry, page_elem);
+		uint32_t *pd = vme->thread->pagedir;
+
+		if(pagedir_is_accessed(pd, vme->vaddr)){
+			pagedir_set_accessed(pd, vme->vaddr, false);
+			referenced = true;
 		}
-		lru_page->vme->is_loaded = false;
-		pagedir_clear_page(page_thread->pagedir, lru_page->vme->vaddr);
-		__free_page(lru_page);
-		break;
 	}
+	return referenced;
+}
+
+/* move PAGE to the back of lru list TYPE */
+static void
+lru_move(struct page *page, int type)
+{
+	del_page_from_lru_list(page);
+	page->lru_type = type;
+	list_push_back(&lru_lists[type], &page->lru);
+	lru_cnt[type]++;
+}
+
+/* refill the inactive FILE or anonymous list while it is shorter
+   than the active one. pages referenced since the last scan stay
+   active, the rest become inactive */
+static void
+shrink_active_list(bool file)
+{
+	int active = file ? LRU_ACTIVE_FILE : LRU_ACTIVE_ANON;
+	int inactive = file ? LRU_INACTIVE_FILE : LRU_INACTIVE_ANON;
+	size_t scan = lru_cnt[active];
+
+	while(scan-- > 0 && lru_cnt[inactive] < lru_cnt[active]){
+		struct page *page = list_entry(list_front(&lru_lists[active]),
+				struct page, lru);
+
+		if(page_pinned(page) || page_referenced(page))
+			lru_move(page, active);
+		else
+			lru_move(page, inactive);
+	}
+}
 
-    lock_release(&lru_list_lock);
+/* scan the inactive FILE or anonymous list, oldest first, for a
+   victim. a page referenced a second time is promoted to the active
+   list, and a page found on the wrong side moves over. returns NULL
+   if every page was passed over */
+static struct page *
+shrink_inactive_list(bool file)
+{
+	int inactive = file ? LRU_INACTIVE_FILE : LRU_INACTIVE_ANON;
+	size_t scan;
+
+	shrink_active_list(file);
+
+	for(scan = lru_cnt[inactive]; scan > 0; scan--){
+		struct page *page = list_entry(list_front(&lru_lists[inactive]),
+				struct page, lru);
 
-	return;
-}
\ No newline at end of file
+		if(page_pinned(page))
+			lru_move(page, inactive);
+		else if(page_is_file(page) != file)
+			lru_move(page, file ? LRU_INACTIVE_ANON : LRU_INACTIVE_FILE);
+		else if(page_referenced(page))
+			lru_move(page, file ? LRU_ACTIVE_FILE : LRU_ACTIVE_ANON);
+		else
+			return page;
+	}
+	return NULL;
+}
@@ -3,18 +3,52 @@
 #include "vm/page.h"
 #include "lib/kernel/list.h"
 #include <threads/palloc.h>
+#include <threads/synch.h>
+
+/* kswapd wakes when fewer than 1/FRAME_LOW_RATIO of the user pool,
+   but at least FRAME_LOW_MIN frames, are free */
+#define FRAME_LOW_RATIO 32
+#define FRAME_LOW_MIN 4
+
+/* most pages one pin_user_pages() call may pin, so that a few large
+   buffers cannot pin all of memory. larger buffers are pinned and
+   copied a piece at a time */
+#define PIN_USER_MAX 16
+
+/* the lru lists a user frame can be on. file pages are clean pages
+   of executables, which eviction can simply drop */
+enum lru_type{
+	LRU_INACTIVE_FILE,
+	LRU_ACTIVE_FILE,
+	LRU_INACTIVE_ANON,
+	LRU_ACTIVE_ANON,
+	LRU_CNT
+};
 
-struct list lru_list;
 struct lock lru_list_lock;
-struct page *lru_clock;
 
 void lru_list_init(void);
+size_t frame_high_watermark(void);
 void add_page_to_lru_list(struct page *page);
 void del_page_from_lru_list(struct page *page);
 struct page *alloc_page(enum palloc_flags flag);
+struct page *kaddr_to_page(void *kaddr);
 void free_page(void *kaddr);
 void __free_page(struct page *page);
-struct list_elem* get_next_lru_clock(void);
-void try_to_free_pages(void);
+bool try_to_free_pages(void);
+void page_add_vme(struct page *page, struct vm_entry *vme);
+bool put_page(struct vm_entry *vme);
+void drop_page(struct page *page, struct vm_entry *vme);
+struct page *find_text_page(struct vm_entry *vme);
+void add_text_page(struct page *page, struct vm_entry *vme);
+bool fork_page(struct vm_entry *parent_vme, struct vm_entry *copy);
+bool unshare_page(struct vm_entry *vme);
+void wait_on_page_eviction(struct vm_entry *vme);
+struct page *swapcache_take(struct vm_entry *vme);
+void swap_readahead(struct vm_entry *vme);
+void pin_page(struct page *page);
+void unpin_page(struct page *page);
+void pin_user_pages(const void *uaddr, size_t size, bool write);
+void unpin_user_pages(const void *uaddr, size_t size);
 
 #endif 
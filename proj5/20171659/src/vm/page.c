@@ -6,6 +6,7 @@
 #include "filesys/file.h"
 #include "vm/page.h"
 #include "vm/frame.h"
+#include "vm/swap.h"
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
 #include "userprog/syscall.h"
@@ -13,6 +14,8 @@
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include "lib/kernel/list.h"
+#include "lib/kernel/bitmap.h"
+#include "vm/page_cache.h"
 
 void 
 vm_init(struct hash *vm)
@@ -54,16 +57,16 @@ void
 vm_destroy_func(struct hash_elem *e, void *aux UNUSED)
 {
 	struct vm_entry *vme = hash_entry(e, struct vm_entry, elem);
-	void *physical_address;
-
-	/* if virtual address is loaded on physical memory */
-	if(vme->is_loaded == true){
-		/* get physical_address and free page */
-		physical_address = pagedir_get_page(thread_current()->pagedir, vme->vaddr);
-		free_page(physical_address);
-		
-		/* clear page table */
-		pagedir_clear_page(thread_current()->pagedir, vme->vaddr);
+
+	/* if virtual address is loaded on physical memory, unmap it. the
+	   frame is freed unless a forked process still shares it */
+	if(!put_page(vme) && vme->type == VM_ANON){
+		/* a page read ahead holds both its frame and its slot */
+		struct page *page = swapcache_take(vme);
+		if(page != NULL)
+			free_page(page->kaddr);
+		if(vme->swap_slot != BITMAP_ERROR)
+			swap_free(vme->swap_slot);
 	}
 	/* free vm_entry */
 	free(vme);
@@ -87,10 +90,13 @@ find_vme(void *vaddr)
 	return NULL;
 }
 
-/* insert vm_entry to page table */
+/* insert vm_entry to page table. the entry belongs to the process
+   that inserts it */
 bool 
 insert_vme(struct hash *vm, struct vm_entry *vme)
 {
+	vme->thread = thread_current();
+
 	/* if hash_insert is success, return true */
 	if(hash_insert(vm, &vme->elem) == NULL)
 		return true;
@@ -121,4 +127,97 @@ load_file(void *kaddr, struct vm_entry *vme)
 		return true;
 	} 
 	return false;
-}
\ No newline at end of file
+}
+
+/* unmap every page of MMAP_FILE and free it. pages the process
+   wrote to stay dirty in the page cache until written back */
+void 
+do_munmap(struct mmap_file *mmap_file)
+{
+	struct thread *cur = thread_current();
+	struct list_elem *element;
+
+	while(!list_empty(&mmap_file->vme_list)){
+		element = list_pop_front(&mmap_file->vme_list);
+		struct vm_entry *vme = list_entry(element, struct vm_entry, mmap_elem);
+
+		/* give the page back to the page cache */
+		pcache_unmap(vme);
+		delete_vme(&cur->vm, vme);
+	}
+
+	file_close(mmap_file->file);
+	list_remove(&mmap_file->elem);
+	free(mmap_file);
+}
+
+/* copy the supplemental page table and memory mappings of PARENT
+   into the current process, which fork() is creating. pages in
+   memory are shared read-only until either process writes them,
+   and pages in swap share their slot */
+bool
+vm_copy(struct thread *parent)
+{
+	struct thread *cur = thread_current();
+	struct hash_iterator i;
+	struct list_elem *e, *f;
+
+	hash_first(&i, &parent->vm);
+	while(hash_next(&i)){
+		struct vm_entry *vme = hash_entry(hash_cur(&i), struct vm_entry, elem);
+		struct vm_entry *copy;
+
+		/* mapped files are copied with their mappings below */
+		if(vme->type == VM_FILE)
+			continue;
+		copy = malloc(sizeof *copy);
+		if(copy == NULL)
+			return false;
+		*copy = *vme;
+		if(vme->file == parent->executing_file)
+			copy->file = cur->executing_file;
+		if(!insert_vme(&cur->vm, copy)){
+			free(copy);
+			return false;
+		}
+		if(!fork_page(vme, copy))
+			return false;
+	}
+
+	for(e = list_begin(&parent->mmap_list); e != list_end(&parent->mmap_list);
+			e = list_next(e)){
+		struct mmap_file *mmap_file = list_entry(e, struct mmap_file, elem);
+		struct mmap_file *mmap_copy = malloc(sizeof *mmap_copy);
+
+		if(mmap_copy == NULL)
+			return false;
+		mmap_copy->mapid = mmap_file->mapid;
+		mmap_copy->file = file_reopen(mmap_file->file);
+		list_init(&mmap_copy->vme_list);
+		list_push_back(&cur->mmap_list, &mmap_copy->elem);
+		if(mmap_copy->file == NULL)
+			return false;
+
+		/* the page cache keeps one copy of the file for both */
+		for(f = list_begin(&mmap_file->vme_list); f != list_end(&mmap_file->vme_list);
+				f = list_next(f)){
+			struct vm_entry *vme = list_entry(f, struct vm_entry, mmap_elem);
+			struct vm_entry *copy = malloc(sizeof *copy);
+
+			if(copy == NULL)
+				return false;
+			*copy = *vme;
+			copy->file = mmap_copy->file;
+			copy->is_loaded = false;
+			copy->evicting = NULL;
+			copy->swapcache = NULL;
+			if(!insert_vme(&cur->vm, copy)){
+				free(copy);
+				return false;
+			}
+			list_push_back(&mmap_copy->vme_list, &copy->mmap_elem);
+		}
+	}
+	cur->next_mapid = parent->next_mapid;
+	return true;
+}
@@ -2,6 +2,7 @@
 #define VM_PAGE_H
 
 #include <hash.h>
+#include "threads/synch.h"
 
 #define VM_BIN 0
 #define VM_FILE 1
@@ -14,21 +15,40 @@ struct vm_entry{
 	void *vaddr;                       // virtual address 
 	bool writable;                     
 	bool is_loaded;                    // if true, physical memory is loaded
+	struct page *evicting;             // frame being written out, or NULL
+	struct page *swapcache;            // frame read ahead from swap, or NULL
+	struct thread *thread;             // process the entry belongs to
+	struct list_elem page_elem;        // list elem for its frame's vmes
 	struct file *file;
 	struct list_elem mmap_elem;        // list_elem for mmap_file's vm_list
 	size_t offset;
 	size_t read_bytes;                   
 	size_t zero_bytes;
-	size_t swap_slot;
+	size_t swap_slot;                  // slot it holds, or BITMAP_ERROR
 	struct hash_elem elem;             // hash elem for thread's vm
 };
 
+/* struct for a memory mapped file */
+struct mmap_file{
+	int mapid;
+	struct file *file;                 // reopened, so close() keeps it
+	struct list_elem elem;             // list_elem for thread's mmap_list
+	struct list vme_list;              // vm_entries of the mapped pages
+};
+
 /* struct for page */
 struct page{
 	void *kaddr;
-	struct vm_entry *vme;
-	struct thread *pg_thread;
+	struct list vmes;                  // vm_entries mapping it; several
+	                                   // after fork() until one writes
+	int lru_type;                      // lru list the page is on
+	int pin_cnt;                       // pins keeping it from eviction
+	struct inode *text_inode;          // executable a shared read-only
+	size_t text_offset;                // page holds, where in it, and
+	size_t text_bytes;                 // how much, or NULL if not shared
+	struct hash_elem text_elem;        // hash elem for the text pages
 	struct list_elem lru;
+	struct condition evicted;          // signaled once eviction is done
 };
 
 void vm_init(struct hash *vm);
@@ -40,5 +60,7 @@ struct vm_entry *find_vme(void *vaddr);
 bool insert_vme(struct hash *vm, struct vm_entry *vme);
 bool delete_vme(struct hash *vm, struct vm_entry *vme);
 bool load_file(void *kaddr, struct vm_entry *vme);
+void do_munmap(struct mmap_file *mmap_file);
+bool vm_copy(struct thread *parent);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,449 @@
+#include <string.h>
+#include <debug.h>
+#include <round.h>
+#include <threads/malloc.h>
+#include <threads/palloc.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "vm/page_cache.h"
+#include "vm/page.h"
+#include "vm/frame.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+
+/* cached pages, keyed by (inode, index) */
+static struct hash pcache_pages;
+/* cached pages, least recently used first */
+static struct list pcache_lru;
+static size_t pcache_cnt;
+
+/* guards the page cache. frames are freed only with file_lock held
+   too, except those of an inode closed for the last time, so that a
+   page pcache_lookup() found stays valid while file_lock is held */
+static struct lock pcache_lock;
+
+static unsigned pcache_hash_func(const struct hash_elem *e, void *aux);
+static bool pcache_less_func(const struct hash_elem *a,
+		const struct hash_elem *b, void *aux);
+static struct pcache_page *lookup(struct inode *inode, size_t index);
+static struct pcache_page *pcache_read(struct inode *inode, size_t index);
+static void pcache_write_back(struct pcache_page *page);
+static void pcache_free(struct pcache_page *page);
+static void unmap_vme(struct pcache_page *page, struct vm_entry *vme);
+static void collect_dirty(struct pcache_page *page);
+static bool pcache_referenced(struct pcache_page *page);
+static bool pcache_evict(bool mapped);
+static size_t pcache_shrink(size_t page_cnt);
+
+static struct shrinker pcache_shrinker = { .shrink = pcache_shrink, .user = true };
+
+void
+pcache_init(void)
+{
+	hash_init(&pcache_pages, pcache_hash_func, pcache_less_func, NULL);
+	list_init(&pcache_lru);
+	pcache_cnt = 0;
+	lock_init(&pcache_lock);
+	palloc_register_shrinker(&pcache_shrinker);
+}
+
+static unsigned
+pcache_hash_func(const struct hash_elem *e, void *aux UNUSED)
+{
+	struct pcache_page *page = hash_entry(e, struct pcache_page, elem);
+
+	return hash_bytes(&page->inode, sizeof page->inode) ^ hash_int(page->index);
+}
+
+static bool
+pcache_less_func(const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED)
+{
+	struct pcache_page *page_a = hash_entry(a, struct pcache_page, elem);
+	struct pcache_page *page_b = hash_entry(b, struct pcache_page, elem);
+
+	if(page_a->inode != page_b->inode)
+		return page_a->inode < page_b->inode;
+	return page_a->index < page_b->index;
+}
+
+/* find the cached page INDEX of INODE, or NULL if it is not cached */
+struct pcache_page *
+pcache_lookup(struct inode *inode, size_t index)
+{
+	struct pcache_page *page;
+
+	lock_acquire(&pcache_lock);
+	page = lookup(inode, index);
+	lock_release(&pcache_lock);
+	return page;
+}
+
+static struct pcache_page *
+lookup(struct inode *inode, size_t index)
+{
+	struct pcache_page key;
+	struct hash_elem *element;
+
+	key.inode = inode;
+	key.index = index;
+	element = hash_find(&pcache_pages, &key.elem);
+	if(element == NULL)
+		return NULL;
+
+	return hash_entry(element, struct pcache_page, elem);
+}
+
+/* map the page of VME's file that VME covers into VME's process,
+   reading it in if it is not cached yet. returns false if there is
+   no memory for it */
+bool
+pcache_map(struct vm_entry *vme)
+{
+	struct inode *inode = file_get_inode(vme->file);
+	uint32_t *pd = vme->thread->pagedir;
+	struct pcache_page *page;
+	bool success = true;
+
+	lock_acquire(&pcache_lock);
+	if(!vme->is_loaded){
+		page = lookup(inode, vme->offset / PGSIZE);
+		if(page == NULL)
+			page = pcache_read(inode, vme->offset / PGSIZE);
+		else{
+			/* most recently used */
+			list_remove(&page->lru);
+			list_push_back(&pcache_lru, &page->lru);
+		}
+
+		success = page != NULL && pagedir_get_page(pd, vme->vaddr) == NULL
+			&& pagedir_set_page(pd, vme->vaddr, page->kaddr, vme->writable);
+		if(success){
+			list_push_back(&page->vmes, &vme->page_elem);
+			vme->is_loaded = true;
+		}
+	}
+	lock_release(&pcache_lock);
+	return success;
+}
+
+/* read page INDEX of INODE into the cache. returns NULL if no frame
+   can be found for it */
+static struct pcache_page *
+pcache_read(struct inode *inode, size_t index)
+{
+	struct pcache_page *page;
+
+	/* make room under the limit, if an unmapped page can go */
+	if(pcache_cnt >= PCACHE_SIZE)
+		pcache_evict(false);
+
+	page = malloc(sizeof(struct pcache_page));
+	if(page == NULL)
+		return NULL;
+
+	/* get a frame, evicting cached pages and then process pages while
+	   that frees something */
+	page->kaddr = palloc_get_page(PAL_USER);
+	while(page->kaddr == NULL){
+		if(!pcache_evict(true) && !try_to_free_pages()){
+			free(page);
+			return NULL;
+		}
+		page->kaddr = palloc_get_page(PAL_USER);
+	}
+
+	/* read the data, taking it over from the buffer cache */
+	page->inode   = inode;
+	page->index   = index;
+	list_init(&page->vmes);
+	page->pin_cnt = 0;
+	page->dirty   = inode_read_uncached(inode, page->kaddr, PGSIZE,
+			index * PGSIZE);
+
+	hash_insert(&pcache_pages, &page->elem);
+	list_push_back(&pcache_lru, &page->lru);
+	pcache_cnt++;
+	return page;
+}
+
+/* drop VME's mapping of its page, if it has one. what the mapping
+   wrote stays in the page cache */
+void
+pcache_unmap(struct vm_entry *vme)
+{
+	lock_acquire(&pcache_lock);
+	if(vme->is_loaded){
+		struct pcache_page *page = lookup(file_get_inode(vme->file),
+				vme->offset / PGSIZE);
+
+		ASSERT(page != NULL);
+		unmap_vme(page, vme);
+	}
+	lock_release(&pcache_lock);
+}
+
+/* take VME's mapping of PAGE out of its process's page table */
+static void
+unmap_vme(struct pcache_page *page, struct vm_entry *vme)
+{
+	uint32_t *pd = vme->thread->pagedir;
+
+	/* unmap first, so the dirty bit cannot change after it is read */
+	pagedir_clear_page(pd, vme->vaddr);
+	if(pagedir_is_dirty(pd, vme->vaddr))
+		page->dirty = true;
+	vme->is_loaded = false;
+	list_remove(&vme->page_elem);
+}
+
+/* fold the dirty bits PAGE's mappers set since the last check into
+   PAGE, clearing them, so that only a page written since it was last
+   written back goes to disk again */
+static void
+collect_dirty(struct pcache_page *page)
+{
+	struct list_elem *e;
+
+	for(e = list_begin(&page->vmes); e != list_end(&page->vmes); e = list_next(e)){
+		struct vm_entry *vme = list_entry(e, struct vm_entry, page_elem);
+		uint32_t *pd = vme->thread->pagedir;
+
+		if(pagedir_is_dirty(pd, vme->vaddr)){
+			pagedir_set_dirty(pd, vme->vaddr, false);
+			page->dirty = true;
+		}
+	}
+}
+
+/* keep the page VME maps from being evicted until pcache_unpin().
+   returns false if it is not mapped, having just been evicted */
+bool
+pcache_pin(struct vm_entry *vme)
+{
+	bool mapped;
+
+	lock_acquire(&pcache_lock);
+	mapped = vme->is_loaded;
+	if(mapped)
+		lookup(file_get_inode(vme->file), vme->offset / PGSIZE)->pin_cnt++;
+	lock_release(&pcache_lock);
+	return mapped;
+}
+
+void
+pcache_unpin(struct vm_entry *vme)
+{
+	struct pcache_page *page;
+
+	lock_acquire(&pcache_lock);
+	page = lookup(file_get_inode(vme->file), vme->offset / PGSIZE);
+	ASSERT(page != NULL && page->pin_cnt > 0);
+	page->pin_cnt--;
+	lock_release(&pcache_lock);
+}
+
+/* zero the part of INODE's cached pages past LENGTH bytes, which a
+   mapping may have written to but which is not file data */
+void
+pcache_clear_past(struct inode *inode, off_t length)
+{
+	struct pcache_page *page;
+
+	lock_acquire(&pcache_lock);
+	page = lookup(inode, length / PGSIZE);
+	if(page != NULL && length % PGSIZE != 0)
+		memset((uint8_t *)page->kaddr + length % PGSIZE, 0,
+				PGSIZE - length % PGSIZE);
+	lock_release(&pcache_lock);
+}
+
+/* drop INODE's cached pages past LENGTH bytes once the file is cut
+   to that length. mapped pages stay for their mappers, zeroed like
+   the part of the last page past LENGTH */
+void
+pcache_truncate(struct inode *inode, off_t length)
+{
+	size_t first = DIV_ROUND_UP(length, PGSIZE);
+	struct list_elem *element;
+
+	lock_acquire(&pcache_lock);
+	element = list_begin(&pcache_lru);
+	while(element != list_end(&pcache_lru)){
+		struct pcache_page *page = list_entry(element, struct pcache_page, lru);
+		element = list_next(element);
+
+		if(page->inode != inode || page->index < first)
+			continue;
+		page->dirty = false;
+		if(list_empty(&page->vmes) && page->pin_cnt == 0)
+			pcache_free(page);
+		else
+			memset(page->kaddr, 0, PGSIZE);
+	}
+	lock_release(&pcache_lock);
+	pcache_clear_past(inode, length);
+}
+
+/* write back INODE's dirty pages, including those a mapper wrote */
+void
+pcache_flush(struct inode *inode)
+{
+	struct list_elem *element;
+
+	lock_acquire(&pcache_lock);
+	for(element = list_begin(&pcache_lru); element != list_end(&pcache_lru);
+			element = list_next(element)){
+		struct pcache_page *page = list_entry(element, struct pcache_page, lru);
+		if(page->inode == inode)
+			pcache_write_back(page);
+	}
+	lock_release(&pcache_lock);
+}
+
+/* write back every dirty page */
+void
+pcache_flush_all(void)
+{
+	struct list_elem *element;
+
+	lock_acquire(&pcache_lock);
+	for(element = list_begin(&pcache_lru); element != list_end(&pcache_lru);
+			element = list_next(element))
+		pcache_write_back(list_entry(element, struct pcache_page, lru));
+	lock_release(&pcache_lock);
+}
+
+/* write back and free every page of INODE, which is being closed
+   for the last time and so cannot be mapped anywhere */
+void
+pcache_evict_inode(struct inode *inode)
+{
+	struct list_elem *element;
+
+	lock_acquire(&pcache_lock);
+	element = list_begin(&pcache_lru);
+	while(element != list_end(&pcache_lru)){
+		struct pcache_page *page = list_entry(element, struct pcache_page, lru);
+		element = list_next(element);
+
+		if(page->inode == inode){
+			ASSERT(list_empty(&page->vmes) && page->pin_cnt == 0);
+			pcache_write_back(page);
+			pcache_free(page);
+		}
+	}
+	lock_release(&pcache_lock);
+}
+
+/* write PAGE to its file if it may be newer than the disk */
+static void
+pcache_write_back(struct pcache_page *page)
+{
+	if(inode_is_removed(page->inode)){
+		page->dirty = false;
+		return;
+	}
+	collect_dirty(page);
+	if(page->dirty){
+		inode_write_uncached(page->inode, page->kaddr, PGSIZE,
+				page->index * PGSIZE);
+		page->dirty = false;
+	}
+}
+
+static void
+pcache_free(struct pcache_page *page)
+{
+	hash_delete(&pcache_pages, &page->elem);
+	list_remove(&page->lru);
+	palloc_free_page(page->kaddr);
+	free(page);
+	pcache_cnt--;
+}
+
+/* whether a mapper of PAGE touched it since the last check */
+static bool
+pcache_referenced(struct pcache_page *page)
+{
+	struct list_elem *e;
+	bool referenced = false;
+
+	for(e = list_begin(&page->vmes); e != list_end(&page->vmes); e = list_next(e)){
+		struct vm_entry *vme = list_entry(e, struct vm_entry, page_elem);
+		uint32_t *pd = vme->thread->pagedir;
+
+		if(pagedir_is_accessed(pd, vme->vaddr)){
+			pagedir_set_accessed(pd, vme->vaddr, false);
+			referenced = true;
+		}
+	}
+	return referenced;
+}
+
+/* evict the least recently used page that nothing maps or pins. if
+   every page is mapped and MAPPED, take the least recently used one
+   not touched since the last scan away from its mappers instead,
+   who fault it back in when they need it. returns false if no page
+   can go */
+static bool
+pcache_evict(bool mapped)
+{
+	struct list_elem *element;
+	struct pcache_page *victim = NULL;
+
+	for(element = list_begin(&pcache_lru); element != list_end(&pcache_lru);
+			element = list_next(element)){
+		struct pcache_page *page = list_entry(element, struct pcache_page, lru);
+		if(list_empty(&page->vmes) && page->pin_cnt == 0){
+			victim = page;
+			break;
+		}
+	}
+
+	/* second chance: a page touched since the last scan goes to the
+	   back, and two rounds find one unless all are pinned */
+	for(size_t i = 0; victim == NULL && mapped && i < 2 * pcache_cnt; i++){
+		struct pcache_page *page = list_entry(list_pop_front(&pcache_lru),
+				struct pcache_page, lru);
+
+		list_push_back(&pcache_lru, &page->lru);
+		if(page->pin_cnt == 0 && !pcache_referenced(page))
+			victim = page;
+	}
+	if(victim == NULL)
+		return false;
+
+	while(!list_empty(&victim->vmes))
+		unmap_vme(victim, list_entry(list_front(&victim->vmes),
+				struct vm_entry, page_elem));
+	pcache_write_back(victim);
+	pcache_free(victim);
+	return true;
+}
+
+/* shrinker for the user pool: evicts cached pages, mapped or not.
+   it gives up rather than wait for the locks, since the allocating
+   thread may hold them */
+static size_t
+pcache_shrink(size_t page_cnt)
+{
+	size_t freed = 0;
+
+	if(lock_held_by_current_thread(&file_lock) || !lock_try_acquire(&file_lock))
+		return 0;
+	if(lock_held_by_current_thread(&pcache_lock) || !lock_try_acquire(&pcache_lock)){
+		lock_release(&file_lock);
+		return 0;
+	}
+
+	while(freed < page_cnt && pcache_evict(true))
+		freed++;
+
+	lock_release(&pcache_lock);
+	lock_release(&file_lock);
+	return freed;
+}
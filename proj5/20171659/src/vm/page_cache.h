@@ -0,0 +1,41 @@
+#ifndef VM_PAGE_CACHE_H
+#define VM_PAGE_CACHE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+struct inode;
+struct vm_entry;
+
+/* Most pages the page cache keeps before evicting unmapped ones. */
+#define PCACHE_SIZE 64
+
+/* struct for a page of file data. while it is cached, it is the
+   current copy of that data for mappings and read/write alike */
+struct pcache_page{
+	struct inode *inode;               // file the page belongs to
+	size_t index;                      // page index within the file
+	void *kaddr;                       // frame holding the data
+	int map_cnt;                       // number of user mappings
+	struct list vmes;                  // vm_entries mapping it
+	int pin_cnt;                       // pins keeping it from eviction
+	bool dirty;                        // newer than the disk
+	struct hash_elem elem;             // hash elem for the page table
+	struct list_elem lru;              // list elem for the lru list
+};
+
+void pcache_init(void);
+struct pcache_page *pcache_lookup(struct inode *inode, size_t index);
+bool pcache_map(struct vm_entry *vme);
+void pcache_unmap(struct vm_entry *vme);
+bool pcache_pin(struct vm_entry *vme);
+void pcache_unpin(struct vm_entry *vme);
+void pcache_clear_past(struct inode *inode, off_t length);
+void pcache_truncate(struct inode *inode, off_t length);
+void pcache_flush(struct inode *inode);
+void pcache_flush_all(void);
+void pcache_evict_inode(struct inode *inode);
+
+#endif
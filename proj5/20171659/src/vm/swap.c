@@ -1,9 +1,16 @@
 #include "vm/frame.h"
 #include "vm/page.h"
 #include "vm/swap.h"
+#include "vm/zswap.h"
 #include "devices/block.h"
 #include "threads/synch.h"
 #include "lib/kernel/bitmap.h"
+#include "threads/malloc.h"
+#include <stdint.h>
+
+/* number of vm_entries that hold each used slot. fork() lets parent
+   and child share a slot until one of them swaps it back in */
+static uint16_t *swap_refs;
 
 void 
 swap_init(void)
@@ -19,26 +26,67 @@ swap_init(void)
 		return;
 	/* initialize bitmap */
 	bitmap_set_all(swap_map, SWAP_FREE);
+	swap_refs = calloc(bitmap_size(swap_map), sizeof *swap_refs);
+	if(swap_refs == NULL){
+		bitmap_destroy(swap_map);
+		swap_map = NULL;
+		return;
+	}
 	/* initialize lock value */
 	lock_init(&swap_lock);
+	zswap_init();
 }
 
 void 
 swap_in(size_t used_index, void* kaddr)
+{
+	swap_read(used_index, kaddr);
+	swap_free(used_index);
+}
+
+/* read slot USED_INDEX into KADDR, keeping the slot */
+void
+swap_read(size_t used_index, void *kaddr)
 {
 	lock_acquire(&swap_lock);
 	
 	/* check if used_index is empty slot */
-	if(bitmap_test(swap_map, used_index) == SWAP_FREE)
+	if(bitmap_test(swap_map, used_index) == SWAP_FREE){
+		lock_release(&swap_lock);
 		return;
+	}
 
-	/* read from swap disk to physical memory */
+	/* read from swap disk to physical memory, unless it is compressed */
+	if(zswap_load(used_index, kaddr)){
+		lock_release(&swap_lock);
+		return;
+	}
 	for(int i = 0; i < SECTORS_PER_PAGE; i++)
 		block_read(swap_block, used_index * SECTORS_PER_PAGE + i, (uint8_t *)kaddr + i * BLOCK_SECTOR_SIZE);
 
-	/* change bitmap 1 to 0 */
-	bitmap_flip(swap_map, used_index);
+	lock_release(&swap_lock);
+}
 
+/* give slot USED_INDEX back. it is freed once no one holds it */
+void
+swap_free(size_t used_index)
+{
+	lock_acquire(&swap_lock);
+	ASSERT(swap_refs[used_index] > 0);
+	if(--swap_refs[used_index] == 0){
+		zswap_invalidate(used_index);
+		bitmap_set(swap_map, used_index, SWAP_FREE);
+	}
+	lock_release(&swap_lock);
+}
+
+/* take another hold on used slot USED_INDEX */
+void
+swap_dup(size_t used_index)
+{
+	lock_acquire(&swap_lock);
+	ASSERT(swap_refs[used_index] > 0 && swap_refs[used_index] < UINT16_MAX);
+	swap_refs[used_index]++;
 	lock_release(&swap_lock);
 }
 
@@ -46,18 +94,43 @@ size_t
 swap_out(void *kaddr)
 {
 	size_t free_index;
+
+	swap_out_cluster(&kaddr, 1, &free_index);
+	return free_index;
+}
+
+/* write the CNT pages at KADDRS to swap and store the slot of each
+   in SLOTS, BITMAP_ERROR if swap is full. pages that compress well
+   stay in zswap until it fills; the rest go to one run of adjacent
+   slots when there is one, so the disk writes them in a single
+   sweep instead of seeking for each */
+void
+swap_out_cluster(void **kaddrs, size_t cnt, size_t *slots)
+{
+	size_t first;
+
+	if(cnt == 0)
+		return;
 	lock_acquire(&swap_lock);
 
-	/* find SWAP_FREE index. if there is no SWAP_FREE index, return*/
-	free_index = bitmap_scan_and_flip(swap_map, 0, 1, SWAP_FREE);
-	if(free_index == BITMAP_ERROR)
-		return BITMAP_ERROR;
+	/* find a run of SWAP_FREE slots. if there is none, scatter */
+	first = bitmap_scan_and_flip(swap_map, 0, cnt, SWAP_FREE);
 
-	/* write to swap disk */
-	for(int i = 0; i < SECTORS_PER_PAGE; i++)
-		block_write(swap_block, free_index * SECTORS_PER_PAGE + i, (uint8_t *)kaddr + i * BLOCK_SECTOR_SIZE);
+	for(size_t p = 0; p < cnt; p++){
+		size_t free_index = first != BITMAP_ERROR ? first + p
+			: bitmap_scan_and_flip(swap_map, 0, 1, SWAP_FREE);
+
+		slots[p] = free_index;
+		if(free_index == BITMAP_ERROR)
+			continue;
+		swap_refs[free_index] = 1;
+		if(zswap_store(free_index, kaddrs[p]))
+			continue;
+
+		/* write to swap disk */
+		for(int i = 0; i < SECTORS_PER_PAGE; i++)
+			block_write(swap_block, free_index * SECTORS_PER_PAGE + i, (uint8_t *)kaddrs[p] + i * BLOCK_SECTOR_SIZE);
+	}
 
 	lock_release(&swap_lock);
-	
-	return free_index;
 }
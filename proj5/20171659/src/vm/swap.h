@@ -5,12 +5,22 @@
 #define SWAP_FREE 0
 #define SWAP_USED 1
 
+/* most victims one eviction pass writes to swap together */
+#define SWAP_CLUSTER 8
+
+/* pages after a swapped in one that are read ahead with it */
+#define SWAP_READAHEAD (SWAP_CLUSTER - 1)
+
 struct lock swap_lock;
 struct bitmap *swap_map;
 struct block *swap_block;
 
 void swap_init(void);
 void swap_in(size_t used_index, void* kaddr);
+void swap_read(size_t used_index, void *kaddr);
+void swap_free(size_t used_index);
+void swap_dup(size_t used_index);
 size_t swap_out(void* kaddr);
+void swap_out_cluster(void **kaddrs, size_t cnt, size_t *slots);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,223 @@
+#include <string.h>
+#include <debug.h>
+#include <threads/malloc.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "vm/zswap.h"
+#include "vm/swap.h"
+#include "threads/vaddr.h"
+
+/* a compressed page is a series of groups, each a flag byte and up
+   to 8 tokens. a token whose flag bit is clear is a literal byte;
+   one whose bit is set is 2 bytes: a 6-bit length less LZ_MATCH_MIN
+   and a 10-bit distance back to an earlier copy of the bytes */
+#define LZ_MATCH_MIN 3
+#define LZ_MATCH_MAX (LZ_MATCH_MIN + 63)
+#define LZ_OFFSET_MAX 1023
+#define LZ_TABLE_SIZE 1024
+
+/* compressed pages, keyed by swap slot */
+static struct hash zswap_entries;
+/* compressed pages, oldest first */
+static struct list zswap_lru;
+static size_t zswap_bytes;
+
+/* the swapper holds swap_lock around every call, which also covers
+   these scratch buffers */
+static uint16_t lz_table[LZ_TABLE_SIZE];  // last position + 1 per hash
+static uint8_t zswap_buf[ZSWAP_MAX_LEN];
+static uint8_t zswap_page[PGSIZE];
+
+static unsigned zswap_hash_func(const struct hash_elem *e, void *aux);
+static bool zswap_less_func(const struct hash_elem *a,
+		const struct hash_elem *b, void *aux);
+static struct zswap_entry *zswap_lookup(size_t slot);
+static void zswap_free(struct zswap_entry *entry);
+static void zswap_write_back(void);
+static size_t lz_compress(const uint8_t *src, uint8_t *dst, size_t limit);
+static void lz_decompress(const uint8_t *src, uint8_t *dst);
+
+void 
+zswap_init(void)
+{
+	hash_init(&zswap_entries, zswap_hash_func, zswap_less_func, NULL);
+	list_init(&zswap_lru);
+	zswap_bytes = 0;
+}
+
+static unsigned 
+zswap_hash_func(const struct hash_elem *e, void *aux UNUSED)
+{
+	struct zswap_entry *entry = hash_entry(e, struct zswap_entry, elem);
+
+	return hash_int(entry->slot);
+}
+
+static bool 
+zswap_less_func(const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED)
+{
+	struct zswap_entry *entry_a = hash_entry(a, struct zswap_entry, elem);
+	struct zswap_entry *entry_b = hash_entry(b, struct zswap_entry, elem);
+
+	return entry_a->slot < entry_b->slot;
+}
+
+/* find the compressed page of SLOT, or NULL if it is on the disk */
+static struct zswap_entry *
+zswap_lookup(size_t slot)
+{
+	struct zswap_entry key;
+	struct hash_elem *element;
+
+	key.slot = slot;
+	element = hash_find(&zswap_entries, &key.elem);
+	return element != NULL ? hash_entry(element, struct zswap_entry, elem) : NULL;
+}
+
+/* drop ENTRY */
+static void
+zswap_free(struct zswap_entry *entry)
+{
+	hash_delete(&zswap_entries, &entry->elem);
+	list_remove(&entry->lru);
+	zswap_bytes -= entry->len;
+	free(entry);
+}
+
+/* write the oldest compressed page to its slot on the swap device */
+static void
+zswap_write_back(void)
+{
+	struct zswap_entry *entry = list_entry(list_front(&zswap_lru),
+			struct zswap_entry, lru);
+
+	lz_decompress(entry->data, zswap_page);
+	for(int i = 0; i < SECTORS_PER_PAGE; i++)
+		block_write(swap_block, entry->slot * SECTORS_PER_PAGE + i, zswap_page + i * BLOCK_SECTOR_SIZE);
+	zswap_free(entry);
+}
+
+/* keep the page at KADDR, evicted to SLOT, compressed in memory
+   instead of writing it to the swap device. the oldest pages are
+   written out to make room. returns false if the page does not
+   compress well or memory is short, and the caller writes it */
+bool
+zswap_store(size_t slot, const void *kaddr)
+{
+	struct zswap_entry *entry;
+	size_t len;
+
+	len = lz_compress(kaddr, zswap_buf, sizeof zswap_buf);
+	if(len == 0)
+		return false;
+	entry = malloc(sizeof *entry + len);
+	if(entry == NULL)
+		return false;
+	entry->slot = slot;
+	entry->len = len;
+	memcpy(entry->data, zswap_buf, len);
+
+	while(zswap_bytes + len > ZSWAP_POOL_PAGES * PGSIZE)
+		zswap_write_back();
+	hash_insert(&zswap_entries, &entry->elem);
+	list_push_back(&zswap_lru, &entry->lru);
+	zswap_bytes += len;
+	return true;
+}
+
+/* decompress the page of SLOT into KADDR, keeping it. returns false
+   if it is on the swap device */
+bool
+zswap_load(size_t slot, void *kaddr)
+{
+	struct zswap_entry *entry = zswap_lookup(slot);
+
+	if(entry == NULL)
+		return false;
+	lz_decompress(entry->data, kaddr);
+	return true;
+}
+
+/* forget the page of SLOT, which is being freed */
+void
+zswap_invalidate(size_t slot)
+{
+	struct zswap_entry *entry = zswap_lookup(slot);
+
+	if(entry != NULL)
+		zswap_free(entry);
+}
+
+/* compress the page at SRC into DST. returns the compressed length,
+   or 0 if it would exceed LIMIT bytes */
+static size_t
+lz_compress(const uint8_t *src, uint8_t *dst, size_t limit)
+{
+	size_t s = 0, d = 0, flags = 0;
+	int bit = 8;
+
+	memset(lz_table, 0, sizeof lz_table);
+	while(s < PGSIZE){
+		/* start a group if there is room for a whole one */
+		if(bit == 8){
+			if(d + 1 + 8 * 2 > limit)
+				return 0;
+			flags = d;
+			dst[d++] = 0;
+			bit = 0;
+		}
+
+		/* look for an earlier copy of the next bytes */
+		if(s + LZ_MATCH_MAX <= PGSIZE){
+			unsigned h = (src[s] << 16 | src[s + 1] << 8 | src[s + 2]) * 2654435761u;
+			size_t prev = lz_table[h >> 22];
+
+			lz_table[h >> 22] = s + 1;
+			if(prev != 0 && s - (prev - 1) <= LZ_OFFSET_MAX
+					&& memcmp(src + prev - 1, src + s, LZ_MATCH_MIN) == 0){
+				size_t off = s - (prev - 1);
+				size_t len = LZ_MATCH_MIN;
+
+				while(len < LZ_MATCH_MAX && src[s + len] == src[s + len - off])
+					len++;
+				dst[flags] |= 1 << bit;
+				dst[d++] = (len - LZ_MATCH_MIN) << 2 | off >> 8;
+				dst[d++] = off & 0xff;
+				s += len;
+				bit++;
+				continue;
+			}
+		}
+		dst[d++] = src[s++];
+		bit++;
+	}
+	return d;
+}
+
+/* decompress the page at SRC into DST */
+static void
+lz_decompress(const uint8_t *src, uint8_t *dst)
+{
+	size_t s = 0, d = 0;
+	uint8_t flags = 0;
+	int bit = 8;
+
+	while(d < PGSIZE){
+		if(bit == 8){
+			flags = src[s++];
+			bit = 0;
+		}
+		if(flags & (1 << bit)){
+			size_t len = (src[s] >> 2) + LZ_MATCH_MIN;
+			size_t off = (src[s] & 3) << 8 | src[s + 1];
+
+			s += 2;
+			for(; len > 0 && d < PGSIZE; len--, d++)
+				dst[d] = dst[d - off];
+		}
+		else
+			dst[d++] = src[s++];
+		bit++;
+	}
+}
@@ -0,0 +1,33 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Most kernel pages' worth of compressed data zswap keeps before
+   writing the oldest of it to the swap device. */
+#define ZSWAP_POOL_PAGES 64
+
+/* a page that does not compress below this many bytes goes
+   straight to the swap device */
+#define ZSWAP_MAX_LEN 2048
+
+/* struct for a compressed page. it stands in for the swap slot it
+   was evicted to until it is loaded, freed or written back */
+struct zswap_entry{
+	size_t slot;                       // swap slot the page belongs to
+	size_t len;                        // bytes in data
+	struct hash_elem elem;             // hash elem for the entry table
+	struct list_elem lru;              // list elem for the lru list
+	uint8_t data[];                    // the compressed page
+};
+
+void zswap_init(void);
+bool zswap_store(size_t slot, const void *kaddr);
+bool zswap_load(size_t slot, void *kaddr);
+void zswap_invalidate(size_t slot);
+
+#endif